@@ -0,0 +1,322 @@
+/*
+ * attrib.c - Attribution of cache hits and misses to address ranges
+ *
+ * The ranges are kept sorted by start address, so the range of an
+ * access is found by binary search. Accesses outside every range are
+ * counted as "(other)". Misses are also counted per block in an
+ * open-addressing table, from which attrib_print picks the blocks
+ * that missed most.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attrib.h"
+
+#define NAME_LEN 64
+
+typedef struct
+{
+    char name[NAME_LEN];
+    uint64_t start, end; /* [start, end) */
+    long hits, misses, evictions;
+} range_t;
+
+struct attrib
+{
+    int block_bits;
+
+    range_t *ranges; /* sorted by start */
+    int nranges;
+    range_t other; /* accesses outside every range */
+
+    int has_markers; /* only count from marker_start to marker_end */
+    uint64_t marker_start, marker_end;
+    int active; /* between the markers */
+
+    /* misses per block: open addressing on block number + 1 (0 is free) */
+    uint64_t *blocks;
+    long *block_misses;
+    size_t slots;
+    size_t used;
+};
+
+static size_t hash_block(uint64_t block)
+{
+    return (size_t)(block * 0x9E3779B97F4A7C15ULL >> 17);
+}
+
+attrib_t *attrib_new(int block_bits)
+{
+    attrib_t *attrib = (attrib_t *)calloc(1, sizeof(attrib_t));
+
+    if (!attrib)
+        return NULL;
+    attrib->block_bits = block_bits;
+    strcpy(attrib->other.name, "(other)");
+    attrib->active = 1;
+    attrib->slots = 1024;
+    attrib->blocks = (uint64_t *)calloc(attrib->slots, sizeof(uint64_t));
+    attrib->block_misses = (long *)calloc(attrib->slots, sizeof(long));
+    if (!attrib->blocks || !attrib->block_misses)
+    {
+        attrib_free(attrib);
+        return NULL;
+    }
+    return attrib;
+}
+
+void attrib_free(attrib_t *attrib)
+{
+    if (!attrib)
+        return;
+    free(attrib->ranges);
+    free(attrib->blocks);
+    free(attrib->block_misses);
+    free(attrib);
+}
+
+static int compare_start(const void *a, const void *b)
+{
+    const range_t *x = (const range_t *)a, *y = (const range_t *)b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/*
+ * add_range - Append a range; attrib_load sorts them once all are read
+ */
+static int add_range(attrib_t *attrib, const char *name, uint64_t start, uint64_t end)
+{
+    range_t *ranges = (range_t *)realloc(attrib->ranges, (attrib->nranges + 1) * sizeof(range_t));
+    range_t *r;
+
+    if (!ranges)
+        return -1;
+    attrib->ranges = ranges;
+    r = &ranges[attrib->nranges++];
+    memset(r, 0, sizeof(range_t));
+    snprintf(r->name, NAME_LEN, "%s", name);
+    r->start = start;
+    r->end = end;
+    return 0;
+}
+
+int attrib_load(attrib_t *attrib, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256], name[NAME_LEN], end_str[32];
+    unsigned long long start, end;
+    int lineno = 0, ok = 1;
+
+    if (!fp)
+    {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while (ok && fgets(line, sizeof(line), fp))
+    {
+        char *p = line + strspn(line, " \t");
+        lineno++;
+        if (*p == '#' || *p == '\n' || *p == '\0')
+            continue;
+
+        // a bare pair of addresses gives the markers
+        if (sscanf(p, "%llx %llx %1s", &start, &end, name) == 2)
+        {
+            attrib->has_markers = 1;
+            attrib->marker_start = start;
+            attrib->marker_end = end;
+            attrib->active = 0;
+            continue;
+        }
+        if (sscanf(p, "%63s %llx %31s", name, &start, end_str) != 3 ||
+            sscanf(end_str + (end_str[0] == '+'), "%llx", &end) != 1)
+        {
+            fprintf(stderr, "%s:%d: expected \"name start end\" or \"name start +size\"\n",
+                    path, lineno);
+            ok = 0;
+            break;
+        }
+        if (end_str[0] == '+')
+            end += start;
+        if (end <= start)
+        {
+            fprintf(stderr, "%s:%d: range %s is empty\n", path, lineno, name);
+            ok = 0;
+        }
+        else if (add_range(attrib, name, start, end) < 0)
+        {
+            fprintf(stderr, "out of memory reading %s\n", path);
+            ok = 0;
+        }
+    }
+    fclose(fp);
+    if (!ok)
+        return -1;
+
+    qsort(attrib->ranges, attrib->nranges, sizeof(range_t), compare_start);
+    for (int i = 1; i < attrib->nranges; i++)
+    {
+        if (attrib->ranges[i].start < attrib->ranges[i - 1].end)
+        {
+            fprintf(stderr, "%s: ranges %s and %s overlap\n", path, attrib->ranges[i - 1].name,
+                    attrib->ranges[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * find_range - The range holding addr, or NULL
+ */
+static const range_t *find_range(const attrib_t *attrib, uint64_t addr)
+{
+    int lo = 0, hi = attrib->nranges;
+
+    // find the last range starting at or below addr
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (attrib->ranges[mid].start <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0 || addr >= attrib->ranges[lo - 1].end)
+        return NULL;
+    return &attrib->ranges[lo - 1];
+}
+
+/*
+ * count_miss - Add a miss of the block holding addr to the table
+ */
+static void count_miss(attrib_t *attrib, uint64_t addr)
+{
+    uint64_t block = addr >> attrib->block_bits;
+    size_t mask = attrib->slots - 1;
+    size_t i = hash_block(block) & mask;
+
+    while (attrib->blocks[i] && attrib->blocks[i] != block + 1)
+        i = (i + 1) & mask;
+    if (attrib->blocks[i])
+    {
+        attrib->block_misses[i]++;
+        return;
+    }
+    attrib->blocks[i] = block + 1;
+    attrib->block_misses[i] = 1;
+
+    if (2 * ++attrib->used > attrib->slots)
+    {
+        // grow: rehash into tables twice the size
+        uint64_t *old_blocks = attrib->blocks;
+        long *old_misses = attrib->block_misses;
+        size_t old_slots = attrib->slots;
+
+        attrib->slots *= 2;
+        attrib->blocks = (uint64_t *)calloc(attrib->slots, sizeof(uint64_t));
+        attrib->block_misses = (long *)calloc(attrib->slots, sizeof(long));
+        if (!attrib->blocks || !attrib->block_misses)
+            abort();
+        mask = attrib->slots - 1;
+        for (size_t j = 0; j < old_slots; j++)
+        {
+            if (!old_blocks[j])
+                continue;
+            i = hash_block(old_blocks[j] - 1) & mask;
+            while (attrib->blocks[i])
+                i = (i + 1) & mask;
+            attrib->blocks[i] = old_blocks[j];
+            attrib->block_misses[i] = old_misses[j];
+        }
+        free(old_blocks);
+        free(old_misses);
+    }
+}
+
+void attrib_access(attrib_t *attrib, const trace_access_t *access, cache_result_t result)
+{
+    range_t *r;
+
+    // the markers are part of the region, like in test-trans
+    if (attrib->has_markers && access->addr == attrib->marker_start)
+        attrib->active = 1;
+    if (!attrib->active)
+        return;
+    if (attrib->has_markers && access->addr == attrib->marker_end)
+        attrib->active = 0;
+
+    r = (range_t *)find_range(attrib, access->addr);
+    if (!r)
+        r = &attrib->other;
+    if (result == CACHE_HIT)
+        r->hits++;
+    else
+    {
+        r->misses++;
+        r->evictions += result == CACHE_EVICT;
+        count_miss(attrib, access->addr);
+    }
+    // the store of a modify always hits
+    if (access->op == 'M')
+        r->hits++;
+}
+
+static void print_range(const range_t *r, FILE *out)
+{
+    long total = r->hits + r->misses;
+
+    fprintf(out, "%-16s %12ld %12ld %12ld %8.2f%%\n", r->name, r->hits, r->misses, r->evictions,
+            total ? 100.0 * r->misses / total : 0.0);
+}
+
+static int compare_misses(const void *a, const void *b)
+{
+    const uint64_t *x = (const uint64_t *)a, *y = (const uint64_t *)b;
+
+    // most misses first, then lowest address
+    if (x[1] != y[1])
+        return x[1] < y[1] ? 1 : -1;
+    return x[0] < y[0] ? -1 : x[0] > y[0];
+}
+
+void attrib_print(const attrib_t *attrib, FILE *out)
+{
+    uint64_t(*lines)[2] = (uint64_t(*)[2])malloc(attrib->used * sizeof(*lines));
+    size_t n = 0;
+
+    fprintf(out, "%-16s %12s %12s %12s %9s\n", "range", "hits", "misses", "evictions", "miss rate");
+    for (int i = 0; i < attrib->nranges; i++)
+        print_range(&attrib->ranges[i], out);
+    print_range(&attrib->other, out);
+
+    if (!lines)
+        return;
+    for (size_t i = 0; i < attrib->slots; i++)
+    {
+        if (attrib->blocks[i])
+        {
+            lines[n][0] = (attrib->blocks[i] - 1) << attrib->block_bits;
+            lines[n][1] = (uint64_t)attrib->block_misses[i];
+            n++;
+        }
+    }
+    qsort(lines, n, sizeof(*lines), compare_misses);
+
+    fprintf(out, "lines with the most misses:\n");
+    for (size_t i = 0; i < n && i < ATTRIB_TOP; i++)
+    {
+        const range_t *r = find_range(attrib, lines[i][0]);
+        char where[NAME_LEN + 24];
+
+        if (r)
+            snprintf(where, sizeof(where), "%s+%#llx", r->name,
+                     (unsigned long long)(lines[i][0] - r->start));
+        else
+            snprintf(where, sizeof(where), "%s", attrib->other.name);
+        fprintf(out, "  %16llx %-24s %12llu\n", (unsigned long long)lines[i][0], where,
+                (unsigned long long)lines[i][1]);
+    }
+    free(lines);
+}
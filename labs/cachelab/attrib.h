@@ -0,0 +1,46 @@
+/*
+ * attrib.h - Attribution of cache hits and misses to address ranges
+ *
+ * A range map is a text file with one named range per line:
+ *
+ *     A 0x10a0c0 0x11a0c0     start and end (exclusive), in hex
+ *     B 0x14a0c0 +0x10000     start and size
+ *
+ * Blank lines and lines starting with '#' are ignored. A line holding
+ * just two hex addresses gives the start and end markers of the region
+ * of interest, as in the .marker file tracegen writes: then only the
+ * accesses from the start marker to the end marker are attributed.
+ */
+#ifndef ATTRIB_H
+#define ATTRIB_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cache.h"
+#include "trace.h"
+
+/* Number of missing lines attrib_print lists */
+#define ATTRIB_TOP 10
+
+typedef struct attrib attrib_t;
+
+/* Create an empty attribution for blocks of 2^block_bits bytes */
+attrib_t *attrib_new(int block_bits);
+
+void attrib_free(attrib_t *attrib);
+
+/*
+ * Read the ranges of a range map file; returns -1 and prints the
+ * reason to stderr if it cannot be read, is malformed, or has
+ * overlapping ranges.
+ */
+int attrib_load(attrib_t *attrib, const char *path);
+
+/* Count one access whose load or store had the given result */
+void attrib_access(attrib_t *attrib, const trace_access_t *access, cache_result_t result);
+
+/* Print the counts of every range and the lines that missed most */
+void attrib_print(const attrib_t *attrib, FILE *out);
+
+#endif /* ATTRIB_H */
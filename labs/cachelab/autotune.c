@@ -0,0 +1,363 @@
+/*
+ * autotune.c - Searches blocked transpose kernels against the cache model
+ *
+ * A candidate kernel is a tiling of the matrix plus three choices:
+ *
+ * - the tile size, TH rows by TW columns of A, each a power of two;
+ * - the tile order: tiles along the rows of A, or down its columns;
+ * - the order inside a tile: along the rows of A (reading A
+ *   sequentially) or down its columns (writing B sequentially), moving
+ *   RB elements at a time through locals: all RB loads, then all RB
+ *   stores, so that a line of A and one of B that share a set do not
+ *   evict each other at every element.
+ *
+ * Each candidate is run on the access stream the generated code would
+ * produce at -O0, fed to a cache from cache.c, with A and B where
+ * tracegen puts them. The best ones are listed, and the best is written
+ * out as a transpose function ready to paste into trans.c.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+#define MAX_TILE 64
+#define MAX_RB 8 /* locals: i, j, r, c and RB more stay within the lab's 12 */
+
+/* tracegen's static int A[256][256], B[256][256] are adjacent */
+#define TRACEGEN_B_OFFSET (256 * 256 * 4)
+
+typedef struct
+{
+    int th, tw;       /* tile rows and columns of A */
+    int tiles_by_col; /* visit the tiles down the columns of A */
+    int inner_by_col; /* inside a tile, go down the columns of A */
+    int rb;           /* elements moved through locals at a time */
+    long misses, hits, evictions;
+} cand_t;
+
+static const char *help_msg = "Usage: ./autotune [-h] -s <s> -E <E> -b <b> -M <cols> -N <rows>\n"
+                              "                  [-a <addr>] [-B <addr>] [-n <count>] [-o <file>]\n"
+                              "   -h: Optional help flag that prints usage info\n"
+                              "   -s: <s>: Number of set index bits of the target cache\n"
+                              "   -E: <E>: Associativity of the target cache\n"
+                              "   -b: <b>: Number of block bits of the target cache\n"
+                              "   -M: <cols>: Number of columns of A\n"
+                              "   -N: <rows>: Number of rows of A\n"
+                              "   -a: <addr>: Address of A (hex, default 0x10c0e0)\n"
+                              "   -B: <addr>: Address of B (hex, default A + 256 * 256 * 4)\n"
+                              "   -n: <count>: Number of best candidates to list (default 10)\n"
+                              "   -o: <file>: Write the best kernel there instead of stdout\n";
+
+static cache_t *cache;
+static uint64_t base_a, base_b;
+
+static inline void load(int M, int r, int c)
+{
+    cache_access(cache, base_a + 4 * ((uint64_t)r * M + c));
+}
+
+static inline void store(int N, int c, int r)
+{
+    cache_access(cache, base_b + 4 * ((uint64_t)c * N + r));
+}
+
+/*
+ * run_tile - Issue the accesses of one tile in the order of the code
+ *     emit_kernel writes: full runs of rb through locals, then the
+ *     ragged end of each row (or column) one element at a time
+ */
+static void run_tile(const cand_t *k, int M, int N, int i, int j)
+{
+    int r, c, x, rend = i + k->th < N ? i + k->th : N, cend = j + k->tw < M ? j + k->tw : M;
+
+    if (!k->inner_by_col)
+    {
+        for (r = i; r < rend; r++)
+        {
+            for (c = j; c + k->rb <= cend; c += k->rb)
+            {
+                for (x = 0; x < k->rb; x++)
+                    load(M, r, c + x);
+                for (x = 0; x < k->rb; x++)
+                    store(N, c + x, r);
+            }
+            for (; c < cend; c++)
+            {
+                load(M, r, c);
+                store(N, c, r);
+            }
+        }
+    }
+    else
+    {
+        for (c = j; c < cend; c++)
+        {
+            for (r = i; r + k->rb <= rend; r += k->rb)
+            {
+                for (x = 0; x < k->rb; x++)
+                    load(M, r + x, c);
+                for (x = 0; x < k->rb; x++)
+                    store(N, c, r + x);
+            }
+            for (; r < rend; r++)
+            {
+                load(M, r, c);
+                store(N, c, r);
+            }
+        }
+    }
+}
+
+static void run_kernel(const cand_t *k, int M, int N)
+{
+    int i, j;
+
+    if (!k->tiles_by_col)
+    {
+        for (i = 0; i < N; i += k->th)
+            for (j = 0; j < M; j += k->tw)
+                run_tile(k, M, N, i, j);
+    }
+    else
+    {
+        for (j = 0; j < M; j += k->tw)
+            for (i = 0; i < N; i += k->th)
+                run_tile(k, M, N, i, j);
+    }
+}
+
+/*
+ * emit_kernel - Write candidate k as C code in the style of trans.c
+ */
+static void emit_kernel(FILE *out, const cand_t *k, int M, int N, int s, int E, int b)
+{
+    const char *outer = k->tiles_by_col ? "j" : "i", *inner = k->tiles_by_col ? "i" : "j";
+    const char *row = k->inner_by_col ? "r" : "c", *col = k->inner_by_col ? "c" : "r";
+    const char *run = k->inner_by_col ? "r" : "c"; /* the index moved in runs of rb */
+    const char *run_end = k->inner_by_col ? "i + TH && r < N" : "j + TW && c < M";
+    int x;
+
+    fprintf(out, "/*\n"
+                 " * transpose_tuned - Generated by autotune for M = %d, N = %d on a cache\n"
+                 " *     with s = %d, E = %d, b = %d: %d x %d tiles %s, %s inside\n"
+                 " *     a tile, %d element%s at a time; %ld misses in the model\n"
+                 " */\n",
+            M, N, s, E, b, k->th, k->tw, k->tiles_by_col ? "down the columns" : "along the rows",
+            k->inner_by_col ? "by columns" : "by rows", k->rb, k->rb > 1 ? "s" : "", k->misses);
+    fprintf(out, "#define TH %d\n#define TW %d\n", k->th, k->tw);
+    fprintf(out, "char transpose_tuned_desc[] = \"Tuned %dx%d tiles, %s, %s, %d at a time\";\n",
+            k->th, k->tw, k->tiles_by_col ? "column order" : "row order",
+            k->inner_by_col ? "by columns" : "by rows", k->rb);
+    fprintf(out, "void transpose_tuned(int M, int N, int A[N][M], int B[M][N])\n{\n");
+    fprintf(out, "    int i, j, r, c");
+    for (x = 0; x < k->rb && k->rb > 1; x++)
+        fprintf(out, ", a%d", x);
+    fprintf(out, ";\n\n");
+
+    fprintf(out, "    for (%s = 0; %s < %s; %s += %s)\n", outer, outer,
+            k->tiles_by_col ? "M" : "N", outer, k->tiles_by_col ? "TW" : "TH");
+    fprintf(out, "    {\n");
+    fprintf(out, "        for (%s = 0; %s < %s; %s += %s)\n", inner, inner,
+            k->tiles_by_col ? "N" : "M", inner, k->tiles_by_col ? "TH" : "TW");
+    fprintf(out, "        {\n");
+    if (!k->inner_by_col)
+        fprintf(out, "            for (%s = i; %s < i + TH && %s < N; %s++)\n", col, col, col, col);
+    else
+        fprintf(out, "            for (%s = j; %s < j + TW && %s < M; %s++)\n", col, col, col, col);
+    fprintf(out, "            {\n");
+    if (k->rb > 1)
+    {
+        const char *lim = k->inner_by_col ? "i + TH" : "j + TW", *dim = k->inner_by_col ? "N" : "M";
+
+        fprintf(out, "                for (%s = %s; %s + %d <= %s && %s + %d <= %s; %s += %d)\n",
+                run, k->inner_by_col ? "i" : "j", run, k->rb, lim, run, k->rb, dim, run, k->rb);
+        fprintf(out, "                {\n");
+        for (x = 0; x < k->rb; x++)
+        {
+            if (x == 0)
+                fprintf(out, "                    a0 = A[r][c];\n");
+            else if (k->inner_by_col)
+                fprintf(out, "                    a%d = A[r + %d][c];\n", x, x);
+            else
+                fprintf(out, "                    a%d = A[r][c + %d];\n", x, x);
+        }
+        for (x = 0; x < k->rb; x++)
+        {
+            if (x == 0)
+                fprintf(out, "                    B[c][r] = a0;\n");
+            else if (k->inner_by_col)
+                fprintf(out, "                    B[c][r + %d] = a%d;\n", x, x);
+            else
+                fprintf(out, "                    B[c + %d][r] = a%d;\n", x, x);
+        }
+        fprintf(out, "                }\n");
+        fprintf(out, "                for (; %s < %s; %s++)\n", run, run_end, run);
+    }
+    else
+        fprintf(out, "                for (%s = %s; %s < %s; %s++)\n", row,
+                k->inner_by_col ? "i" : "j", row, run_end, row);
+    fprintf(out, "                    B[c][r] = A[r][c];\n");
+    fprintf(out, "            }\n        }\n    }\n}\n");
+    fprintf(out, "#undef TH\n#undef TW\n");
+}
+
+/* How far a tile is from square: |log2 TH - log2 TW| */
+static int skew(const cand_t *k)
+{
+    int d = 0;
+
+    for (int th = k->th, tw = k->tw; th != tw; d++)
+    {
+        if (th > tw)
+            th /= 2;
+        else
+            tw /= 2;
+    }
+    return d;
+}
+
+static int compare_cands(const void *a, const void *b)
+{
+    const cand_t *x = (const cand_t *)a, *y = (const cand_t *)b;
+
+    // fewest misses; among equals, fewest locals, then the squarest and
+    // largest tile
+    if (x->misses != y->misses)
+        return x->misses < y->misses ? -1 : 1;
+    if (x->rb != y->rb)
+        return x->rb - y->rb;
+    if (skew(x) != skew(y))
+        return skew(x) - skew(y);
+    return y->th * y->tw - x->th * x->tw;
+}
+
+int main(int argc, char **argv)
+{
+    int set_bits = -1, lines = 0, block_bits = 0, M = 0, N = 0, top = 10;
+    int opt, ncands = 0, th, tw, order, rb;
+    int have_b = 0;
+    char *out_path = NULL;
+    cand_t *cands;
+    FILE *out = stdout;
+
+    base_a = 0x10c0e0;
+    while ((opt = getopt(argc, argv, "hs:E:b:M:N:a:B:n:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'h':
+            printf("%s", help_msg);
+            exit(EXIT_SUCCESS);
+        case 's':
+            set_bits = atoi(optarg);
+            break;
+        case 'E':
+            lines = atoi(optarg);
+            break;
+        case 'b':
+            block_bits = atoi(optarg);
+            break;
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 'a':
+            base_a = strtoull(optarg, NULL, 16);
+            break;
+        case 'B':
+            base_b = strtoull(optarg, NULL, 16);
+            have_b = 1;
+            break;
+        case 'n':
+            top = atoi(optarg);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            printf("%s", help_msg);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (set_bits < 0 || lines <= 0 || block_bits <= 0 || M <= 0 || N <= 0)
+    {
+        printf("Missing required command line argument\n%s", help_msg);
+        exit(EXIT_FAILURE);
+    }
+    if (!have_b)
+        base_b = base_a + TRACEGEN_B_OFFSET;
+
+    // tile sizes up to MAX_TILE, 2 tile orders x 2 inner orders, rb up to the run length
+    cands = (cand_t *)calloc(7 * 7 * 4 * 4, sizeof(cand_t));
+    if (!cands)
+    {
+        printf("malloc of candidates failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (th = 1; th <= MAX_TILE; th *= 2)
+    {
+        for (tw = 1; tw <= MAX_TILE; tw *= 2)
+        {
+            for (order = 0; order < 4; order++)
+            {
+                for (rb = 1; rb <= MAX_RB; rb *= 2)
+                {
+                    cand_t *k = &cands[ncands];
+
+                    k->th = th;
+                    k->tw = tw;
+                    k->tiles_by_col = order & 1;
+                    k->inner_by_col = order >> 1;
+                    k->rb = rb;
+                    // a run longer than the tile side is never full
+                    if (rb > (k->inner_by_col ? th : tw))
+                        continue;
+
+                    cache = cache_new(set_bits, lines, block_bits);
+                    if (!cache)
+                    {
+                        printf("malloc of cache failed.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    run_kernel(k, M, N);
+                    k->misses = cache->misses;
+                    k->hits = cache->hits;
+                    k->evictions = cache->evictions;
+                    cache_free(cache);
+                    ncands++;
+                }
+            }
+        }
+    }
+    qsort(cands, ncands, sizeof(cand_t), compare_cands);
+
+    printf("%d candidates for %d x %d on s=%d, E=%d, b=%d\n", ncands, M, N, set_bits, lines,
+           block_bits);
+    printf("%4s %4s %-7s %-7s %3s %10s %10s\n", "TH", "TW", "tiles", "inner", "RB", "misses",
+           "evictions");
+    for (int i = 0; i < ncands && i < top; i++)
+    {
+        const cand_t *k = &cands[i];
+        printf("%4d %4d %-7s %-7s %3d %10ld %10ld\n", k->th, k->tw,
+               k->tiles_by_col ? "columns" : "rows", k->inner_by_col ? "columns" : "rows", k->rb,
+               k->misses, k->evictions);
+    }
+
+    if (out_path && (out = fopen(out_path, "w")) == NULL)
+    {
+        fprintf(stderr, "cannot open %s for writing\n", out_path);
+        exit(EXIT_FAILURE);
+    }
+    if (out == stdout)
+        printf("\n");
+    emit_kernel(out, &cands[0], M, N, set_bits, lines, block_bits);
+    if (out != stdout)
+        fclose(out);
+    free(cands);
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * bench-trans.c - Measures the wall-clock time of the registered
+ *     transpose functions, as a companion to the miss counts that
+ *     test-trans reports. trans.c is compiled with optimization here.
+ *
+ * Each function is validated once and then run repeatedly on the same
+ * M x N matrix until BENCH_MIN_SECONDS have passed; the best of
+ * BENCH_TRIALS such runs is reported in nanoseconds per element and in
+ * GB/s of memory traffic (reading A and writing B), next to memcpy of
+ * the same number of bytes. With -t, the multithreaded transpose of
+ * ptrans.c is timed as well, with 1, 2, 4, ... up to the given number
+ * of threads.
+ */
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "ptrans.h"
+
+#define BENCH_MIN_SECONDS 0.05
+#define BENCH_TRIALS 5
+
+/* External function defined in trans.c */
+extern void registerFunctions();
+
+/* External variables defined in cachelab.c */
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+
+/* What to time: a registered function, memcpy, or the parallel transpose */
+typedef struct {
+    int func;     /* index into func_list, or -1 */
+    int nthreads; /* > 0: transpose_parallel with this many threads */
+} job_t;
+
+static int M, N;
+static int *A, *B;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run_job(const job_t *job)
+{
+    if (job->func >= 0)
+        (*func_list[job->func].func_ptr)(M, N, (int (*)[M])A, (int (*)[N])B);
+    else if (job->nthreads > 0)
+        transpose_parallel(M, N, (int (*)[M])A, (int (*)[N])B, job->nthreads);
+    else
+        memcpy(B, A, (size_t)M * N * sizeof(int));
+}
+
+/*
+ * time_job - Best seconds per run of job over the trials
+ */
+static double time_job(const job_t *job)
+{
+    double best = 1e30;
+    int trial;
+
+    for (trial = 0; trial < BENCH_TRIALS; trial++) {
+        long calls = 0;
+        double start = now(), elapsed;
+
+        do {
+            run_job(job);
+            calls++;
+            elapsed = now() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        if (elapsed / calls < best)
+            best = elapsed / calls;
+    }
+    return best;
+}
+
+/*
+ * is_transposed - Check B = A^T without a copy of the expected result
+ */
+static int is_transposed(void)
+{
+    size_t r, c;
+
+    for (r = 0; r < (size_t)N; r++)
+        for (c = 0; c < (size_t)M; c++)
+            if (B[c * N + r] != A[r * M + c])
+                return 0;
+    return 1;
+}
+
+/*
+ * report - Validate and time job, and print a line for it
+ */
+static void report(const char *name, const job_t *job, double memcpy_gbs)
+{
+    size_t elems = (size_t)M * N;
+    double seconds, gbs;
+
+    memset(B, 0, elems * sizeof(int));
+    run_job(job);
+    if ((job->func >= 0 || job->nthreads > 0) && !is_transposed()) {
+        printf("%-48s incorrect result\n", name);
+        return;
+    }
+    seconds = time_job(job);
+    gbs = 2.0 * elems * sizeof(int) / seconds / 1e9;
+    printf("%-48s %8.3f ns/element %8.2f GB/s", name, seconds * 1e9 / elems, gbs);
+    if (memcpy_gbs > 0)
+        printf(" %6.1f%% of memcpy", 100.0 * gbs / memcpy_gbs);
+    printf("\n");
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-t <threads>] -M <cols> -N <rows>\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h            Print this help message.\n");
+    printf("  -t <threads>  Also time the multithreaded transpose\n");
+    printf("  -M <cols>     Number of columns of A\n");
+    printf("  -N <rows>     Number of rows of A\n");
+    printf("Example: %s -t 8 -M 8192 -N 8192\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    int c, i, nthreads = 0;
+    size_t elems, k;
+    char name[128];
+    job_t job;
+    double memcpy_gbs, seconds;
+
+    while ((c = getopt(argc, argv, "M:N:t:h")) != -1) {
+        switch (c) {
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (M <= 0 || N <= 0) {
+        printf("Error: Missing required argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    elems = (size_t)M * N;
+    A = (int *)malloc(elems * sizeof(int));
+    B = (int *)malloc(elems * sizeof(int));
+    if (!A || !B) {
+        printf("Error: Cannot allocate %dx%d matrices\n", M, N);
+        exit(1);
+    }
+    /* Place the pages of B where the threads will write them */
+    if (nthreads > 0)
+        first_touch_parallel(M, N, (int (*)[N])B, nthreads);
+    for (k = 0; k < elems; k++)
+        A[k] = (int)(k * 2654435761u);
+
+    registerFunctions();
+    printf("%dx%d ints (%.1f MB per matrix), best of %d runs of at least %.0f ms\n",
+           M, N, elems * sizeof(int) / 1e6, BENCH_TRIALS, BENCH_MIN_SECONDS * 1e3);
+
+    job.func = -1;
+    job.nthreads = 0;
+    seconds = time_job(&job);
+    memcpy_gbs = 2.0 * elems * sizeof(int) / seconds / 1e9;
+    report("memcpy", &job, 0);
+
+    for (i = 0; i < func_counter; i++) {
+        job.func = i;
+        snprintf(name, sizeof(name), "func %d (%s)", i, func_list[i].description);
+        report(name, &job, memcpy_gbs);
+    }
+    job.func = -1;
+    for (i = 1; nthreads > 0; i *= 2) {
+        job.nthreads = i < nthreads ? i : nthreads;
+        snprintf(name, sizeof(name), "parallel, %d thread%s", job.nthreads,
+                 job.nthreads > 1 ? "s" : "");
+        report(name, &job, memcpy_gbs);
+        if (i >= nthreads)
+            break;
+    }
+
+    free(A);
+    free(B);
+    return 0;
+}
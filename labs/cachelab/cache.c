@@ -0,0 +1,501 @@
+/*
+ * cache.c - A set-associative cache model
+ *
+ * LRU order is kept with a timestamp per line instead of a linked
+ * list: a hit only stores the current clock into the line, and a
+ * replacement picks the line with the oldest stamp. Nothing is
+ * allocated after cache_new, so the cost of an access is a scan over
+ * the E tags of one set.
+ *
+ * The other policies keep their state just as compactly:
+ * - FIFO stores the fill time in the stamp and ignores hits;
+ * - LFU counts uses in the top 24 bits of the stamp, above the fill
+ *   time, so the smallest stamp is the least used (and oldest) line;
+ * - PLRU keeps E - 1 tree bits per set in one 64-bit word;
+ * - SRRIP and BRRIP keep a 2-bit prediction per line in a byte;
+ * - random only needs the generator state.
+ * The policy is a switch in the access path; for LRU the compiler
+ * turns it into one well-predicted branch.
+ *
+ * For highly associative caches the tag scan is done with SSE4.2 or
+ * AVX2 compares of 2 or 4 tags at a time, and the search for the LRU
+ * line with AVX2, picked at run time from what the CPU supports; other
+ * machines and small E use the plain loops.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+#define LFU_SHIFT 40 /* LFU stamps: use count above a 40-bit fill time */
+#define LFU_MAX_COUNT ((1ULL << 23) - 1)
+#define RRPV_MAX 3   /* 2-bit RRIP: 3 means re-reference in the distant future */
+#define BRRIP_LONG 32 /* BRRIP inserts at RRPV_MAX - 1 once per this many fills */
+
+static const char *policy_names[] = {"lru", "fifo", "random", "lfu", "plru", "srrip", "brrip"};
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_SIMD_TAGS
+#endif
+
+/* Below this many ways the scalar loop is as fast as any vector code */
+#define SIMD_MIN_WAYS 16
+
+/*
+ * find_tag_scalar - Return the first of tags[0..n) equal to tag, or -1
+ */
+static int find_tag_scalar(const uint64_t *tags, int n, uint64_t tag)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (tags[i] == tag)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * find_lru_scalar - Return the index of the smallest of stamps[0..n)
+ */
+static int find_lru_scalar(const uint64_t *stamps, int n)
+{
+    int victim = 0;
+
+    for (int i = 1; i < n; i++)
+    {
+        if (stamps[i] < stamps[victim])
+            victim = i;
+    }
+    return victim;
+}
+
+#ifdef HAVE_SIMD_TAGS
+__attribute__((target("sse4.2"))) static int find_tag_sse(const uint64_t *tags, int n,
+                                                          uint64_t tag)
+{
+    __m128i key = _mm_set1_epi64x((long long)tag);
+    int i, mask;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(tags + i));
+        mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, key)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i < n && tags[i] == tag ? i : -1;
+}
+
+__attribute__((target("avx2"))) static int find_tag_avx2(const uint64_t *tags, int n,
+                                                         uint64_t tag)
+{
+    __m256i key = _mm256_set1_epi64x((long long)tag);
+    int i, mask;
+
+    // two compares per iteration to check 8 ways at once
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)(tags + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(tags + i + 4));
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v0, key))) |
+               _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v1, key))) << 4;
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(tags + i));
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    for (; i < n; i++)
+    {
+        if (tags[i] == tag)
+            return i;
+    }
+    return -1;
+}
+
+/* Stamps stay far below 2^63, so the signed 64-bit compare is safe */
+__attribute__((target("avx2"))) static int find_lru_avx2(const uint64_t *stamps, int n)
+{
+    __m256i min = _mm256_set1_epi64x(INT64_MAX);
+    __m256i min_way = _mm256_setzero_si256();
+    __m256i way = _mm256_set_epi64x(3, 2, 1, 0);
+    __m256i four = _mm256_set1_epi64x(4);
+    int64_t lane_min[4], lane_way[4];
+    int i, victim;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(stamps + i));
+        __m256i older = _mm256_cmpgt_epi64(min, v);
+        min = _mm256_blendv_epi8(min, v, older);
+        min_way = _mm256_blendv_epi8(min_way, way, older);
+        way = _mm256_add_epi64(way, four);
+    }
+    _mm256_storeu_si256((__m256i *)lane_min, min);
+    _mm256_storeu_si256((__m256i *)lane_way, min_way);
+    victim = (int)lane_way[0];
+    for (int l = 1; l < 4; l++)
+    {
+        if ((uint64_t)lane_min[l] < stamps[victim])
+            victim = (int)lane_way[l];
+    }
+    for (; i < n; i++)
+    {
+        if (stamps[i] < stamps[victim])
+            victim = i;
+    }
+    return victim;
+}
+#endif
+
+cache_t *cache_new(int set_bits, int lines, int block_bits)
+{
+    cache_t *cache;
+    size_t sets, total;
+
+    if (set_bits < 0 || block_bits < 0 || lines <= 0 ||
+        set_bits + block_bits >= 64 || set_bits >= 32)
+        return NULL;
+    sets = (size_t)1 << set_bits;
+    total = sets * lines;
+
+    cache = (cache_t *)calloc(1, sizeof(cache_t));
+    if (!cache)
+        return NULL;
+    cache->set_bits = set_bits;
+    cache->lines = lines;
+    cache->block_bits = block_bits;
+    cache->set_mask = sets - 1;
+    cache->find_tag = find_tag_scalar;
+    cache->find_lru = find_lru_scalar;
+#ifdef HAVE_SIMD_TAGS
+    if (lines >= SIMD_MIN_WAYS)
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            cache->find_tag = find_tag_avx2;
+            cache->find_lru = find_lru_avx2;
+        }
+        else if (__builtin_cpu_supports("sse4.2"))
+            cache->find_tag = find_tag_sse;
+    }
+#endif
+    cache->tags = (uint64_t *)malloc(total * sizeof(uint64_t));
+    cache->stamps = (uint64_t *)malloc(total * sizeof(uint64_t));
+    cache->dirty = (unsigned char *)malloc(total);
+    cache->fill = (int *)calloc(sets, sizeof(int));
+    if (!cache->tags || !cache->stamps || !cache->dirty || !cache->fill)
+    {
+        cache_free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void cache_free(cache_t *cache)
+{
+    if (!cache)
+        return;
+    free(cache->tags);
+    free(cache->stamps);
+    free(cache->dirty);
+    free(cache->plru);
+    free(cache->rrpv);
+    free(cache->fill);
+    free(cache);
+}
+
+int cache_policy_parse(const char *name, cache_policy_t *policy)
+{
+    for (int i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); i++)
+    {
+        if (strcmp(name, policy_names[i]) == 0)
+        {
+            *policy = (cache_policy_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int cache_set_policy(cache_t *cache, cache_policy_t policy)
+{
+    size_t sets = (size_t)cache->set_mask + 1;
+
+    if (policy == POLICY_PLRU &&
+        (cache->lines > 64 || (cache->lines & (cache->lines - 1)) != 0))
+        return -1;
+    free(cache->plru);
+    free(cache->rrpv);
+    cache->plru = NULL;
+    cache->rrpv = NULL;
+    if (policy == POLICY_PLRU && (cache->plru = (uint64_t *)calloc(sets, sizeof(uint64_t))) == NULL)
+        return -1;
+    if ((policy == POLICY_SRRIP || policy == POLICY_BRRIP) &&
+        (cache->rrpv = (unsigned char *)malloc(sets * cache->lines)) == NULL)
+        return -1;
+    cache->rand_state = 0x9E3779B97F4A7C15ULL;
+    cache->policy = policy;
+    return 0;
+}
+
+static inline uint64_t next_random(cache_t *cache)
+{
+    uint64_t x = cache->rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return cache->rand_state = x;
+}
+
+/*
+ * plru_touch - Point the tree bits of set_id away from way
+ */
+static inline void plru_touch(cache_t *cache, uint64_t set_id, int way)
+{
+    uint64_t tree = cache->plru[set_id];
+    int node = 1;
+
+    for (int half = cache->lines >> 1; half > 0; half >>= 1)
+    {
+        int right = (way & half) != 0;
+
+        // bit set: the LRU side is the right subtree
+        if (right)
+            tree &= ~(1ULL << node);
+        else
+            tree |= 1ULL << node;
+        node = 2 * node + right;
+    }
+    cache->plru[set_id] = tree;
+}
+
+static inline int plru_victim(const cache_t *cache, uint64_t set_id)
+{
+    uint64_t tree = cache->plru[set_id];
+    int node = 1, way = 0;
+
+    for (int half = cache->lines >> 1; half > 0; half >>= 1)
+    {
+        int right = (tree >> node) & 1;
+
+        way |= right ? half : 0;
+        node = 2 * node + right;
+    }
+    return way;
+}
+
+static inline int rrip_victim(cache_t *cache, long base, int fill)
+{
+    unsigned char *rrpv = cache->rrpv + base;
+    int i, oldest = 0;
+
+    for (i = 0; i < fill; i++)
+    {
+        if (rrpv[i] == RRPV_MAX)
+            return i;
+        if (rrpv[i] > rrpv[oldest])
+            oldest = i;
+    }
+    // age the whole set until the oldest line reaches RRPV_MAX
+    int age = RRPV_MAX - rrpv[oldest];
+    for (i = 0; i < fill; i++)
+        rrpv[i] += age;
+    return oldest;
+}
+
+/*
+ * touch - Update the replacement state of line i (at way i - base) on a hit
+ */
+static inline void touch(cache_t *cache, long base, long i)
+{
+    switch (cache->policy)
+    {
+    case POLICY_LRU:
+        cache->stamps[i] = cache->clock;
+        break;
+    case POLICY_LFU:
+        if (cache->stamps[i] >> LFU_SHIFT < LFU_MAX_COUNT)
+            cache->stamps[i] += 1ULL << LFU_SHIFT;
+        break;
+    case POLICY_PLRU:
+        plru_touch(cache, (uint64_t)base / cache->lines, (int)(i - base));
+        break;
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+        cache->rrpv[i] = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * init_line - Set the replacement state of line i, just filled
+ */
+static inline void init_line(cache_t *cache, long base, long i)
+{
+    switch (cache->policy)
+    {
+    case POLICY_LFU:
+        cache->stamps[i] = 1ULL << LFU_SHIFT | (cache->clock & ((1ULL << LFU_SHIFT) - 1));
+        break;
+    case POLICY_PLRU:
+        plru_touch(cache, (uint64_t)base / cache->lines, (int)(i - base));
+        break;
+    case POLICY_SRRIP:
+        cache->rrpv[i] = RRPV_MAX - 1;
+        break;
+    case POLICY_BRRIP:
+        cache->rrpv[i] = next_random(cache) % BRRIP_LONG ? RRPV_MAX : RRPV_MAX - 1;
+        break;
+    default:
+        cache->stamps[i] = cache->clock;
+        break;
+    }
+}
+
+/*
+ * victim - Return the way to replace in the full set starting at base
+ */
+static inline int victim(cache_t *cache, long base, int fill)
+{
+    switch (cache->policy)
+    {
+    case POLICY_RANDOM:
+        return (int)(next_random(cache) % fill);
+    case POLICY_PLRU:
+        return plru_victim(cache, (uint64_t)base / cache->lines);
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+        return rrip_victim(cache, base, fill);
+    default:
+        // LRU, FIFO and LFU all evict the line with the smallest stamp
+        return cache->find_lru(cache->stamps + base, fill);
+    }
+}
+
+/*
+ * find - Return the index of the line holding addr in the flat arrays,
+ *     or -1; *set_base is set to the index of the first line of its set
+ */
+static inline long find(cache_t *cache, uint64_t addr, long *set_base)
+{
+    uint64_t set_id = (addr >> cache->block_bits) & cache->set_mask;
+    uint64_t tag = addr >> (cache->set_bits + cache->block_bits);
+    long base = (long)(set_id * cache->lines);
+    int i = cache->find_tag(cache->tags + base, cache->fill[set_id], tag);
+
+    *set_base = base;
+    return i < 0 ? -1 : base + i;
+}
+
+/*
+ * place - Put the block holding addr into its set, whose first line is
+ *     at base, and return 1 if that evicted a valid line
+ */
+static inline int place(cache_t *cache, uint64_t addr, long base, int dirty)
+{
+    uint64_t set_id = (addr >> cache->block_bits) & cache->set_mask;
+    int shift = cache->set_bits + cache->block_bits;
+    int fill = cache->fill[set_id];
+    long i;
+
+    if (fill < cache->lines)
+    {
+        // cold miss: take the next free line
+        i = base + fill;
+        cache->fill[set_id]++;
+    }
+    else
+    {
+        i = base + victim(cache, base, fill);
+        cache->victim = cache->tags[i] << shift | set_id << cache->block_bits;
+        cache->victim_dirty = cache->dirty[i];
+        cache->evictions++;
+    }
+    cache->tags[i] = addr >> shift;
+    cache->dirty[i] = (unsigned char)dirty;
+    init_line(cache, base, i);
+    return fill == cache->lines;
+}
+
+cache_result_t cache_access(cache_t *cache, uint64_t addr)
+{
+    long base, i;
+
+    cache->clock++;
+    if ((i = find(cache, addr, &base)) >= 0)
+    {
+        touch(cache, base, i);
+        cache->hits++;
+        return CACHE_HIT;
+    }
+    cache->misses++;
+    return place(cache, addr, base, 0) ? CACHE_EVICT : CACHE_MISS;
+}
+
+int cache_probe(const cache_t *cache, uint64_t addr)
+{
+    uint64_t set_id = (addr >> cache->block_bits) & cache->set_mask;
+    uint64_t tag = addr >> (cache->set_bits + cache->block_bits);
+
+    return cache->find_tag(cache->tags + set_id * cache->lines, cache->fill[set_id], tag) >= 0;
+}
+
+int cache_lookup(cache_t *cache, uint64_t addr, int write)
+{
+    long base, i;
+
+    cache->clock++;
+    if ((i = find(cache, addr, &base)) < 0)
+    {
+        cache->misses++;
+        return 0;
+    }
+    touch(cache, base, i);
+    cache->dirty[i] |= (unsigned char)write;
+    cache->hits++;
+    return 1;
+}
+
+int cache_fill(cache_t *cache, uint64_t addr, int dirty)
+{
+    long base, i;
+
+    cache->clock++;
+    if ((i = find(cache, addr, &base)) >= 0)
+    {
+        // already here: a write-back only updates the data
+        cache->dirty[i] |= (unsigned char)dirty;
+        return 0;
+    }
+    return place(cache, addr, base, dirty);
+}
+
+int cache_remove(cache_t *cache, uint64_t addr)
+{
+    uint64_t set_id = (addr >> cache->block_bits) & cache->set_mask;
+    long base, i, last;
+    int dirty;
+
+    if ((i = find(cache, addr, &base)) < 0)
+        return -1;
+    dirty = cache->dirty[i];
+
+    // keep the valid lines of the set contiguous
+    last = base + --cache->fill[set_id];
+    cache->tags[i] = cache->tags[last];
+    cache->stamps[i] = cache->stamps[last];
+    cache->dirty[i] = cache->dirty[last];
+    if (cache->rrpv)
+        cache->rrpv[i] = cache->rrpv[last];
+    return dirty;
+}
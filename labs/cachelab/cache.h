@@ -0,0 +1,105 @@
+/*
+ * cache.h - A set-associative cache model
+ *
+ * The state of the whole cache lives in a few flat arrays that are
+ * allocated once by cache_new: E tags and E last-use stamps for every
+ * set, stored set by set, plus the number of valid lines in each set.
+ * Lines are filled in order, so the valid lines of a set are always
+ * ways [0, fill); cache_remove moves the last valid line into the hole,
+ * so it does not keep the PLRU tree bits of a set meaningful.
+ *
+ * Replacement is LRU unless cache_set_policy picks another policy.
+ *
+ * cache_access is all csim needs. Multi-level simulations and the
+ * prefetchers build on the lower-level calls: a counted lookup that
+ * does not allocate, an uncounted probe and fill, and removal, with a
+ * dirty bit per line.
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+/* Replacement policies */
+typedef enum
+{
+    POLICY_LRU,
+    POLICY_FIFO,
+    POLICY_RANDOM,
+    POLICY_LFU,   /* least frequently used; ties go to the oldest line */
+    POLICY_PLRU,  /* tree pseudo-LRU; E must be a power of two <= 64 */
+    POLICY_SRRIP, /* static re-reference interval prediction, 2-bit */
+    POLICY_BRRIP  /* bimodal RRIP: SRRIP that mostly inserts at distant */
+} cache_policy_t;
+
+/* Outcome of a single access */
+typedef enum
+{
+    CACHE_HIT,
+    CACHE_MISS,
+    CACHE_EVICT /* a miss that replaced a valid line */
+} cache_result_t;
+
+typedef struct
+{
+    int set_bits;   /* s: S = 2^s sets */
+    int lines;      /* E: lines per set */
+    int block_bits; /* b: B = 2^b bytes per block */
+    uint64_t set_mask;
+
+    uint64_t *tags;   /* S * E tags, one set after the other */
+    uint64_t *stamps; /* LRU: last use; FIFO: fill time; LFU: uses << 40 | fill time */
+    unsigned char *dirty; /* written since it was filled */
+    cache_policy_t policy;
+    uint64_t *plru;       /* PLRU: a tree of E - 1 bits for each set */
+    unsigned char *rrpv;  /* RRIP: re-reference prediction of each line, 0-3 */
+    uint64_t rand_state;  /* random and BRRIP: xorshift state */
+    int *fill;        /* number of valid lines in each set */
+    int (*find_tag)(const uint64_t *tags, int n, uint64_t tag);
+    int (*find_lru)(const uint64_t *stamps, int n);
+    uint64_t clock;   /* incremented on every access */
+
+    long hits;
+    long misses;
+    long evictions;
+
+    uint64_t victim;  /* address of the block the last eviction replaced */
+    int victim_dirty; /* and whether it was dirty */
+} cache_t;
+
+/* Create an empty cache, or return NULL if the geometry is unusable */
+cache_t *cache_new(int set_bits, int lines, int block_bits);
+
+void cache_free(cache_t *cache);
+
+/* Switch an empty cache to another policy; returns -1 if it does not fit E */
+int cache_set_policy(cache_t *cache, cache_policy_t policy);
+
+/* Parse a policy name as given to csim -r; returns -1 if unknown */
+int cache_policy_parse(const char *name, cache_policy_t *policy);
+
+/* Access the block holding addr and update the counters */
+cache_result_t cache_access(cache_t *cache, uint64_t addr);
+
+/* Return 1 if the block holding addr is cached, changing nothing */
+int cache_probe(const cache_t *cache, uint64_t addr);
+
+/*
+ * Look addr up and count a hit or a miss, without allocating on a
+ * miss; a hit makes the line most recently used, and dirty if write
+ * is set. Returns 1 on a hit.
+ */
+int cache_lookup(cache_t *cache, uint64_t addr, int write);
+
+/*
+ * Bring the block holding addr into the cache without counting an
+ * access (a fill from below or a write-back from above), and mark it
+ * dirty if dirty is set. Returns 1 if a valid line was evicted; see
+ * victim and victim_dirty.
+ */
+int cache_fill(cache_t *cache, uint64_t addr, int dirty);
+
+/* Drop the block holding addr; returns -1 if absent, else its dirty bit */
+int cache_remove(cache_t *cache, uint64_t addr);
+
+#endif /* CACHE_H */
@@ -4,12 +4,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 #include "cachelab.h"
 #include <time.h>
 
 trans_func_t func_list[MAX_TRANS_FUNCS];
 int func_counter = 0; 
 
+kernel_func_t kernel_list[MAX_KERNEL_FUNCS];
+int kernel_counter = 0;
+static int recorded_counter = 0;
+
 /* 
  * printSummary - Summarize the cache simulation statistics. Student cache simulators
  *                must call this function in order to be properly autograded. 
@@ -81,3 +86,31 @@ void registerTransFunction(void (*trans)(int M, int N, int[N][M], int[M][N]),
     func_list[func_counter].num_evictions =0;
     func_counter++;
 }
+
+/*
+ * registerKernelFunction - Add the given kernel into the list of
+ *     kernels to be evaluated by test-kernels
+ */
+void registerKernelFunction(kernel_kind_t kind, kernel_fn_t kernel, char* desc)
+{
+    assert(kernel_counter < MAX_KERNEL_FUNCS);
+    kernel_list[kernel_counter].kind = kind;
+    kernel_list[kernel_counter].func_ptr = kernel;
+    kernel_list[kernel_counter].recorded_ptr = NULL;
+    kernel_list[kernel_counter].description = desc;
+    kernel_counter++;
+}
+
+/*
+ * registerRecordedKernel - Attach the recorded build of the next
+ *     registered kernel; the two builds of kernels.c register the
+ *     same kernels in the same order
+ */
+void registerRecordedKernel(kernel_kind_t kind, kernel_fn_t kernel, char* desc)
+{
+    assert(recorded_counter < kernel_counter);
+    assert(kernel_list[recorded_counter].kind == kind);
+    assert(strcmp(kernel_list[recorded_counter].description, desc) == 0);
+    kernel_list[recorded_counter].recorded_ptr = kernel;
+    recorded_counter++;
+}
@@ -16,6 +16,25 @@ typedef struct trans_func{
   unsigned int num_evictions;
 } trans_func_t;
 
+#define MAX_KERNEL_FUNCS 100
+
+/* The kinds of kernel test-kernels evaluates, all on n x n doubles */
+typedef enum kernel_kind{
+  KERNEL_GEMM,    /* C += A * B */
+  KERNEL_STENCIL, /* B = 5-point Jacobi step of A, with A's border */
+  KERNEL_INPLACE, /* A = A^T in place; B and C are unused */
+  NUM_KERNEL_KINDS
+} kernel_kind_t;
+
+typedef void (*kernel_fn_t)(int n, double[n][n], double[n][n], double[n][n]);
+
+typedef struct kernel_func{
+  kernel_kind_t kind;
+  kernel_fn_t func_ptr;     /* built with optimization, for timing */
+  kernel_fn_t recorded_ptr; /* built with the hooks of record.h */
+  char* description;
+} kernel_func_t;
+
 /* 
  * printSummary - This function provides a standard way for your cache
  * simulator * to display its final hit and miss statistics
@@ -34,4 +53,11 @@ void correctTrans(int M, int N, int A[N][M], int B[M][N]);
 void registerTransFunction(
     void (*trans)(int M,int N,int[N][M],int[M][N]), char* desc);
 
+/* Add the given kernel to the kernel list */
+void registerKernelFunction(kernel_kind_t kind, kernel_fn_t kernel, char* desc);
+
+/* Attach the recorded build of a kernel to the entry that
+   registerKernelFunction made for it, in the same order */
+void registerRecordedKernel(kernel_kind_t kind, kernel_fn_t kernel, char* desc);
+
 #endif /* CACHELAB_TOOLS_H */
@@ -0,0 +1,198 @@
+/*
+ * classify.c - Compulsory, capacity and conflict misses (the 3 Cs)
+ *
+ * Every block ever accessed has a node, found through an
+ * open-addressing table; a node that has been seen once stays, which
+ * is what tells compulsory misses apart. The blocks of the shadow
+ * cache are the resident nodes, kept on a doubly linked list from
+ * most to least recently used, so a shadow access is O(1) however
+ * large the cache.
+ */
+#include <stdlib.h>
+
+#include "classify.h"
+
+typedef struct
+{
+    uint64_t block;
+    long prev, next; /* neighbours on the LRU list, -1 at the ends */
+    int resident;    /* in the shadow cache */
+} node_t;
+
+struct classify
+{
+    int block_bits;
+    long lines;    /* capacity of the shadow cache */
+    long resident; /* nodes in it */
+    long head;     /* most recently used resident node, or -1 */
+    long tail;     /* least recently used resident node, or -1 */
+
+    node_t *nodes;
+    long nnodes, max_nodes;
+
+    /* node of each block: open addressing on node index + 1 (0 is free) */
+    long *slots;
+    size_t nslots;
+
+    long counts[MISS_KINDS];
+};
+
+static const char *kind_names[MISS_KINDS] = {"compulsory", "capacity", "conflict"};
+
+static size_t hash_block(uint64_t block)
+{
+    return (size_t)(block * 0x9E3779B97F4A7C15ULL >> 17);
+}
+
+classify_t *classify_new(long lines, int block_bits)
+{
+    classify_t *classify = (classify_t *)calloc(1, sizeof(classify_t));
+
+    if (!classify)
+        return NULL;
+    classify->block_bits = block_bits;
+    classify->lines = lines;
+    classify->head = classify->tail = -1;
+    classify->max_nodes = 1024;
+    classify->nodes = (node_t *)malloc(classify->max_nodes * sizeof(node_t));
+    classify->nslots = 2048;
+    classify->slots = (long *)calloc(classify->nslots, sizeof(long));
+    if (!classify->nodes || !classify->slots)
+    {
+        classify_free(classify);
+        return NULL;
+    }
+    return classify;
+}
+
+void classify_free(classify_t *classify)
+{
+    if (!classify)
+        return;
+    free(classify->nodes);
+    free(classify->slots);
+    free(classify);
+}
+
+/*
+ * find_node - The node of block, created (not resident) if it has
+ *     none; sets *seen to whether it already had one
+ */
+static long find_node(classify_t *classify, uint64_t block, int *seen)
+{
+    size_t mask = classify->nslots - 1;
+    size_t i = hash_block(block) & mask;
+    long n;
+
+    while (classify->slots[i] && classify->nodes[classify->slots[i] - 1].block != block)
+        i = (i + 1) & mask;
+    *seen = classify->slots[i] != 0;
+    if (*seen)
+        return classify->slots[i] - 1;
+
+    if (classify->nnodes == classify->max_nodes)
+    {
+        node_t *nodes = (node_t *)realloc(classify->nodes,
+                                          2 * classify->max_nodes * sizeof(node_t));
+        if (!nodes)
+            abort();
+        classify->nodes = nodes;
+        classify->max_nodes *= 2;
+    }
+    n = classify->nnodes++;
+    classify->nodes[n].block = block;
+    classify->nodes[n].resident = 0;
+    classify->slots[i] = n + 1;
+
+    if (2 * classify->nnodes > (long)classify->nslots)
+    {
+        // grow: rehash every node into a table twice the size
+        free(classify->slots);
+        classify->nslots *= 2;
+        classify->slots = (long *)calloc(classify->nslots, sizeof(long));
+        if (!classify->slots)
+            abort();
+        mask = classify->nslots - 1;
+        for (long j = 0; j < classify->nnodes; j++)
+        {
+            i = hash_block(classify->nodes[j].block) & mask;
+            while (classify->slots[i])
+                i = (i + 1) & mask;
+            classify->slots[i] = j + 1;
+        }
+    }
+    return n;
+}
+
+static void unlink_node(classify_t *classify, long n)
+{
+    node_t *node = &classify->nodes[n];
+
+    if (node->prev >= 0)
+        classify->nodes[node->prev].next = node->next;
+    else
+        classify->head = node->next;
+    if (node->next >= 0)
+        classify->nodes[node->next].prev = node->prev;
+    else
+        classify->tail = node->prev;
+}
+
+static void push_front(classify_t *classify, long n)
+{
+    node_t *node = &classify->nodes[n];
+
+    node->prev = -1;
+    node->next = classify->head;
+    if (classify->head >= 0)
+        classify->nodes[classify->head].prev = n;
+    else
+        classify->tail = n;
+    classify->head = n;
+}
+
+int classify_access(classify_t *classify, uint64_t addr, cache_result_t result)
+{
+    int seen, shadow_hit;
+    long n = find_node(classify, addr >> classify->block_bits, &seen);
+    miss_kind_t kind;
+
+    // update the shadow cache whatever the real one did
+    shadow_hit = classify->nodes[n].resident;
+    if (shadow_hit)
+        unlink_node(classify, n);
+    else
+    {
+        if (classify->resident == classify->lines)
+        {
+            long victim = classify->tail;
+            unlink_node(classify, victim);
+            classify->nodes[victim].resident = 0;
+            classify->resident--;
+        }
+        classify->nodes[n].resident = 1;
+        classify->resident++;
+    }
+    push_front(classify, n);
+
+    if (result == CACHE_HIT)
+        return -1;
+    if (!seen)
+        kind = MISS_COMPULSORY;
+    else if (shadow_hit)
+        kind = MISS_CONFLICT;
+    else
+        kind = MISS_CAPACITY;
+    classify->counts[kind]++;
+    return kind;
+}
+
+long classify_count(const classify_t *classify, miss_kind_t kind)
+{
+    return classify->counts[kind];
+}
+
+const char *classify_name(miss_kind_t kind)
+{
+    return kind_names[kind];
+}
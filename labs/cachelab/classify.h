@@ -0,0 +1,44 @@
+/*
+ * classify.h - Compulsory, capacity and conflict misses (the 3 Cs)
+ *
+ * A shadow fully associative LRU cache with as many lines as the real
+ * one sees every access. A miss of the real cache is compulsory if
+ * its block was never accessed before, a capacity miss if the shadow
+ * cache misses too, and a conflict miss if the shadow cache hits: a
+ * cache of the same size without set conflicts would have kept it.
+ */
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include <stdint.h>
+
+#include "cache.h"
+
+typedef enum
+{
+    MISS_COMPULSORY,
+    MISS_CAPACITY,
+    MISS_CONFLICT,
+    MISS_KINDS
+} miss_kind_t;
+
+typedef struct classify classify_t;
+
+/* Create a classifier for a cache of lines blocks of 2^block_bits bytes, or NULL */
+classify_t *classify_new(long lines, int block_bits);
+
+void classify_free(classify_t *classify);
+
+/*
+ * Feed one access with its result on the real cache; returns the
+ * kind of the miss, or -1 for a hit
+ */
+int classify_access(classify_t *classify, uint64_t addr, cache_result_t result);
+
+/* Number of misses of the given kind so far */
+long classify_count(const classify_t *classify, miss_kind_t kind);
+
+/* Name of a kind of miss, as csim prints it */
+const char *classify_name(miss_kind_t kind);
+
+#endif /* CLASSIFY_H */
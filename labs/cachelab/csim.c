@@ -1,4 +1,13 @@
 #include "cachelab.h"
+#include "cache.h"
+#include "trace.h"
+#include "sweep.h"
+#include "parallel.h"
+#include "hier.h"
+#include "attrib.h"
+#include "classify.h"
+#include "prefetch.h"
+#include "sample.h"
 #include <getopt.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -6,30 +15,178 @@
 #include <string.h>
 #include <assert.h>
 
-#define ADDRESS_BITS 64
-
-static const char *help_msg = "Usage: ./csim-ref [-hv] -s <s> -E <E> -b <b> -t <tracefile>\n"
+static const char *help_msg = "Usage: ./csim-ref [-hvaC] [-j <n>] [-r <policy>] [-A <map>] [-P <prefetcher>]\n"
+                              "                  [-S <sampling> [-w <n>]] -s <s> -E <E> -b <b> -t <tracefile>\n"
+                              "                  [-L <s>,<E>,<b>[,<cycles>]]... [-i <policy>] [-W] [-c <cycles>] [-m <cycles>]\n"
                               "   -h: Optional help flag that prints usage info\n"
                               "   -v: Optional verbose flag that displays trace info\n"
+                              "   -a: Optional flag to simulate every s' <= s and E' <= E in one pass\n"
+                              "   -j: <n>: Optional number of threads to split the sets across\n"
+                              "   -r: <policy>: Replacement policy: lru (default), fifo, random, lfu,\n"
+                              "                 plru, srrip or brrip\n"
+                              "   -A: <map>: Optional file of named address ranges (or tracegen's\n"
+                              "              .marker) to report hits and misses for\n"
+                              "   -C: Optional flag to classify misses as compulsory, capacity or\n"
+                              "       conflict\n"
+                              "   -P: <kind>[,<degree>[,<latency>]]: Optional prefetcher: next (next-line),\n"
+                              "       stride (per 4KB region) or stream (stream buffers); degree is\n"
+                              "       how far ahead (default 1, stream 4), latency is in accesses\n"
+                              "       (default 10)\n"
+                              "   -S: <interval>,<window>: Optional sampling: only measure the last\n"
+                              "       window accesses of every interval, and extrapolate\n"
+                              "   -S: <points>: Optional sampling of the intervals a phases points file lists\n"
+                              "   -w: <n>: With -S, only simulate the n accesses before each window\n"
+                              "       (default: all, uncounted)\n"
                               "   -s: <s>: Number of set index bits (S = 2^s is the number of sets)\n"
                               "   -E: <E>: Associativity (number of lines per set)\n"
                               "   -b: <b>: Number of block bits (B = 2^b is the block size)\n"
-                              "   -t: <tracefile>: Name of the valgrind trace to replay\n";
+                              "   -t: <tracefile>: Name of the valgrind trace to replay\n"
+                              "Cache hierarchy (the cache given by -s/-E/-b is L1):\n"
+                              "   -L: <s>,<E>,<b>[,<cycles>]: Add the next lower level (L2, L3, ...)\n"
+                              "   -i: <policy>: Inclusion policy: nine (default), inclusive or exclusive\n"
+                              "   -W: Write-through, no-write-allocate (default: write-back)\n"
+                              "   -c: <cycles>: L1 hit latency (default 4)\n"
+                              "   -m: <cycles>: Memory latency (default 200)\n";
+
+static const char *result_msg[] = {"hit", "miss", "miss eviction"};
+
+static int verbose = 0;
+static attrib_t *attrib = NULL; /* per-range counts, with -A */
+static classify_t *classify = NULL; /* causes of the misses, with -C */
+
+/*
+ * print_access - Print the verbose output line of one access, with
+ *     the cause of a miss if it was classified
+ */
+static void print_access(const trace_access_t *access, cache_result_t result, int kind)
+{
+    if (access->line)
+        printf("%.*s %s%s", access->len, access->line, result_msg[result],
+               access->op == 'M' ? " hit" : "");
+    else
+        printf(" %c %llx,%d %s%s", access->op, (unsigned long long)access->addr,
+               access->size, result_msg[result], access->op == 'M' ? " hit" : "");
+    if (kind >= 0)
+        printf(" (%s)", classify_name(kind));
+    printf("\n");
+}
 
-static long hit, miss, eviction = 0;
+/*
+ * report_access - Classify, print and attribute an access as -C, -v
+ *     and -A ask for
+ */
+static void report_access(const trace_access_t *access, cache_result_t result)
+{
+    int kind = -1;
+
+    if (classify)
+        kind = classify_access(classify, access->addr, result);
+    if (verbose)
+        print_access(access, result, kind);
+    if (attrib)
+        attrib_access(attrib, access, result);
+}
 
-typedef struct cache_line_ele
+/*
+ * print_classes - Print the misses of each kind, from -C
+ */
+static void print_classes(void)
 {
-    long tag_id;
-    struct cache_line_ele *next;
-} cache_line_ele;
+    for (int kind = 0; kind < MISS_KINDS; kind++)
+        printf("%s%s:%ld", kind ? " " : "", classify_name(kind), classify_count(classify, kind));
+    printf("\n");
+}
 
-typedef struct cache_line_head
+/*
+ * run_sampled - Replay the trace with only the windows of sample
+ *     counted, and print and return the extrapolated counts
+ */
+static void run_sampled(trace_t *trace, cache_t *cache, sample_t *sample, long estimate[3])
 {
-    int total;
-    int capacity;
-    cache_line_ele *data;
-} cache_line_head;
+    long error[3];
+    trace_access_t access;
+    while (trace_next(trace, &access))
+    {
+        sample_role_t role = sample_next(sample);
+        if (role == SAMPLE_SKIP)
+            continue;
+        cache_result_t result = cache_access(cache, access.addr);
+        if (access.op == 'M')
+            cache_access(cache, access.addr);
+        if (role == SAMPLE_MEASURE)
+        {
+            sample_count(sample, result, access.op == 'M');
+            report_access(&access, result);
+        }
+    }
+    if (sample_finish(sample) < 0)
+    {
+        printf("The trace ends before the first sampling window does\n");
+        exit(EXIT_FAILURE);
+    }
+    sample_print(sample, stdout);
+    sample_estimate(sample, estimate, error);
+}
+
+/*
+ * run_hierarchy - Replay the trace on a cache hierarchy and print the
+ *     counts of every level, the memory traffic and the AMAT
+ */
+static void run_hierarchy(trace_t *trace, hier_t *hier)
+{
+    trace_access_t access;
+    while (trace_next(trace, &access))
+    {
+        if (access.op != 'S')
+            hier_access(hier, access.addr, 0);
+        if (access.op != 'L')
+            hier_access(hier, access.addr, 1);
+    }
+
+    for (int i = 0; i < hier->nlevels; i++)
+    {
+        level_t *level = &hier->level[i];
+        printf("L%d: hits:%ld misses:%ld evictions:%ld writebacks:%ld back-invalidations:%ld\n",
+               i + 1, level->cache->hits, level->cache->misses, level->cache->evictions,
+               level->writebacks, level->back_invalidations);
+    }
+    printf("memory: reads:%ld writes:%ld\n", hier->mem_reads, hier->mem_writes);
+    printf("AMAT: %.2f cycles\n", hier_amat(hier));
+}
+
+/*
+ * run_sweep - Simulate all caches with up to 2^s sets and E lines in
+ *     a single pass, print a table of their counts and return the
+ *     counts of the largest one
+ */
+static void run_sweep(trace_t *trace, int set_bits, int lines, int block_bits, long *hits,
+                      long *misses, long *evictions)
+{
+    sweep_t *sweep = sweep_new(set_bits, lines, block_bits);
+    if (!sweep)
+    {
+        printf("malloc of cache failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    trace_access_t access;
+    while (trace_next(trace, &access))
+    {
+        sweep_access(sweep, access.addr);
+        if (access.op == 'M')
+            sweep_access(sweep, access.addr);
+    }
+
+    printf("%4s %4s %12s %12s %12s\n", "s", "E", "hits", "misses", "evictions");
+    for (int s = 0; s <= set_bits; s++)
+    {
+        for (int e = 1; e <= lines; e++)
+        {
+            sweep_result(sweep, s, e, hits, misses, evictions);
+            printf("%4d %4d %12ld %12ld %12ld\n", s, e, *hits, *misses, *evictions);
+        }
+    }
+    sweep_free(sweep);
+}
 
 int main(int argc, char **argv)
 {
@@ -39,14 +196,28 @@ int main(int argc, char **argv)
         printf("%s", help_msg);
         exit(EXIT_FAILURE);
     }
-    int set_bits, cache_line_num, block_bits = 0;
-    char *trace_path;
+    int set_bits = -1, cache_line_num = 0, block_bits = 0;
+    char *trace_path = NULL;
     size_t trace_path_len;
 
     int opt = 0;
-    int verbose = 0;
+    char *map_path = NULL;
+    int all_sizes = 0;
+    int classify_misses = 0;
+    int prefetching = 0, prefetch_degree = 0, prefetch_latency = 0;
+    prefetch_kind_t prefetch_kind = PREFETCH_NEXT_LINE;
+    char *sample_arg = NULL;
+    long sample_warm = -1;
+    int nthreads = 1;
+    cache_policy_t policy = POLICY_LRU;
+
+    // cache hierarchy: lower levels as s, E, b, latency
+    int hier_mode = 0, nlower = 0, write_through = 0;
+    int lower[HIER_MAX_LEVELS - 1][4];
+    int l1_latency = 4, mem_latency = 200;
+    inclusion_t inclusion = HIER_NINE;
 
-    while ((opt = getopt(argc, argv, "hvs:E:b:t:")) != -1)
+    while ((opt = getopt(argc, argv, "hvaCj:r:A:P:S:w:s:E:b:t:L:i:Wc:m:")) != -1)
     {
         switch (opt)
         {
@@ -56,9 +227,24 @@ int main(int argc, char **argv)
         case 'v':
             verbose = 1;
             break;
+        case 'a':
+            all_sizes = 1;
+            break;
+        case 'C':
+            classify_misses = 1;
+            break;
+        case 'j':
+            nthreads = atoi(optarg);
+            if (nthreads <= 0)
+            {
+                printf("Invalid value for -%c\n%s", opt, help_msg);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 's':
+            // -s 0 is a fully associative cache
             set_bits = atoi(optarg);
-            if (!set_bits)
+            if (set_bits < 0 || (!set_bits && strcmp(optarg, "0") != 0))
             {
                 printf("Invalid value for -%c\n%s", opt, help_msg);
                 exit(EXIT_FAILURE);
@@ -80,6 +266,77 @@ int main(int argc, char **argv)
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'r':
+            if (cache_policy_parse(optarg, &policy) < 0)
+            {
+                printf("Invalid value for -%c\n%s", opt, help_msg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'A':
+            map_path = optarg;
+            break;
+        case 'P':
+            prefetching = 1;
+            if (prefetch_parse(optarg, &prefetch_kind, &prefetch_degree, &prefetch_latency) < 0)
+            {
+                printf("Invalid value for -%c\n%s", opt, help_msg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'S':
+            sample_arg = optarg;
+            break;
+        case 'w':
+            sample_warm = atol(optarg);
+            if (sample_warm < 0 || (!sample_warm && strcmp(optarg, "0") != 0))
+            {
+                printf("Invalid value for -%c\n%s", opt, help_msg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'L':
+            hier_mode = 1;
+            if (nlower == HIER_MAX_LEVELS - 1)
+            {
+                printf("At most %d cache levels\n", HIER_MAX_LEVELS);
+                exit(EXIT_FAILURE);
+            }
+            lower[nlower][3] = 4 * (nlower + 2) * (nlower + 2);
+            if (sscanf(optarg, "%d,%d,%d,%d", &lower[nlower][0], &lower[nlower][1],
+                       &lower[nlower][2], &lower[nlower][3]) < 3)
+            {
+                printf("Invalid value for -%c\n%s", opt, help_msg);
+                exit(EXIT_FAILURE);
+            }
+            nlower++;
+            break;
+        case 'i':
+            hier_mode = 1;
+            if (strcmp(optarg, "nine") == 0)
+                inclusion = HIER_NINE;
+            else if (strcmp(optarg, "inclusive") == 0)
+                inclusion = HIER_INCLUSIVE;
+            else if (strcmp(optarg, "exclusive") == 0)
+                inclusion = HIER_EXCLUSIVE;
+            else
+            {
+                printf("Invalid value for -%c\n%s", opt, help_msg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'W':
+            hier_mode = 1;
+            write_through = 1;
+            break;
+        case 'c':
+            hier_mode = 1;
+            l1_latency = atoi(optarg);
+            break;
+        case 'm':
+            hier_mode = 1;
+            mem_latency = atoi(optarg);
+            break;
         case 't':
             trace_path_len = strlen(optarg);
             trace_path = (char *)malloc(trace_path_len + 1);
@@ -98,188 +355,240 @@ int main(int argc, char **argv)
             exit(EXIT_FAILURE);
         }
     }
-    // init cache
-    int set_num = 0x1 << set_bits;
-    cache_line_head **cache = (cache_line_head **)malloc(set_num * sizeof(cache_line_head *));
-    if (!cache)
+    if (set_bits < 0 || !cache_line_num || !block_bits || !trace_path)
     {
-        printf("malloc of cache failed.\n");
+        printf("Missing required command line argument\n%s", help_msg);
         exit(EXIT_FAILURE);
     }
-    for (int i = 0; i < set_num; i++)
+
+    if (policy == POLICY_PLRU)
     {
-        cache_line_head *head = (cache_line_head *)malloc(sizeof(cache_line_head));
-        if (!head)
+        int bad = cache_line_num > 64 || (cache_line_num & (cache_line_num - 1));
+        for (int i = 0; i < nlower; i++)
+            bad |= lower[i][1] > 64 || (lower[i][1] & (lower[i][1] - 1));
+        if (bad)
+        {
+            printf("plru needs E to be a power of two no larger than 64\n");
+            exit(EXIT_FAILURE);
+        }
+        // removing a block moves another into its way, which the tree bits follow
+        if (hier_mode && inclusion != HIER_NINE)
         {
-            printf("malloc of cache line failed.\n");
+            printf("plru cannot be combined with -i inclusive or exclusive\n");
             exit(EXIT_FAILURE);
         }
-        head->total = cache_line_num;
-        head->capacity = 0;
-        head->data = NULL;
-        cache[i] = head;
     }
-    // init mask
-    unsigned long mask_tag, mask_set = 0x1;
-    mask_set = (0x1 << set_bits) - 1;
-    mask_tag = (0x1 << (ADDRESS_BITS - set_bits - block_bits)) - 1;
 
-    // scan trace file
-    FILE *trace_file = fopen(trace_path, "r");
-    if (!trace_file)
+    if (map_path)
     {
-        fprintf(stderr, "cannot open %s for reading\n", trace_path);
+        if (all_sizes || hier_mode)
+        {
+            printf("-A cannot be combined with -a or a cache hierarchy\n");
+            exit(EXIT_FAILURE);
+        }
+        attrib = attrib_new(block_bits);
+        if (!attrib)
+        {
+            printf("malloc of attribution failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        if (attrib_load(attrib, map_path) < 0)
+            exit(EXIT_FAILURE);
+    }
+
+    if (classify_misses)
+    {
+        if (all_sizes || hier_mode)
+        {
+            printf("-C cannot be combined with -a or a cache hierarchy\n");
+            exit(EXIT_FAILURE);
+        }
+        classify = classify_new((long)cache_line_num << set_bits, block_bits);
+        if (!classify)
+        {
+            printf("malloc of miss classification failed.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (prefetching && (all_sizes || hier_mode || nthreads > 1))
+    {
+        printf("-P cannot be combined with -a, -j or a cache hierarchy\n");
         exit(EXIT_FAILURE);
     }
-    int buffer_size = 255;
-    char buffer[buffer_size];
-    while (fgets(buffer, buffer_size, trace_file))
+
+    sample_t *sample = NULL;
+    if (sample_arg)
     {
-        if (buffer[0] != ' ')
-            continue;
-        if (verbose)
-            buffer[strlen(buffer) - 1] = ' ';
-        long addr = strtol(&buffer[3], NULL, 16);
-        long tag_id = (addr >> (set_bits + block_bits)) & mask_tag, set_id = (addr >> block_bits) & mask_set;
-        assert(set_id < set_num);
-        char mode = buffer[1];
-        if (cache[set_id]->capacity == 0)
+        long interval, window;
+
+        if (all_sizes || hier_mode || nthreads > 1 || map_path || classify || prefetching)
         {
-            // cold miss
-            miss++;
-            if (mode == 'M')
-                hit++;
-            if (verbose)
-            {
-                strcat(buffer, "miss");
-                if (mode == 'M')
-                    strcat(buffer, " hit");
-            }
-            cache_line_ele *new_ele = (cache_line_ele *)malloc(sizeof(cache_line_ele));
-            if (!new_ele)
+            printf("-S cannot be combined with -a, -j, -A, -C, -P or a cache hierarchy\n");
+            exit(EXIT_FAILURE);
+        }
+        if (sscanf(sample_arg, "%ld,%ld", &interval, &window) == 2)
+        {
+            sample = sample_periodic(interval, window);
+            if (!sample)
             {
-                fprintf(stderr, "malloc for new cache line element failed\n");
+                printf("Invalid value for -S\n%s", help_msg);
                 exit(EXIT_FAILURE);
             }
-            new_ele->tag_id = tag_id;
-            new_ele->next = NULL;
-            cache[set_id]->capacity++;
-            cache[set_id]->data = new_ele;
         }
-        else
+        else if (!(sample = sample_load(sample_arg)))
+            exit(EXIT_FAILURE);
+        sample_set_warm(sample, sample_warm);
+    }
+
+    // open trace file
+    trace_t *trace = trace_open(trace_path);
+    if (!trace)
+    {
+        fprintf(stderr, "cannot open %s for reading\n", trace_path);
+        exit(EXIT_FAILURE);
+    }
+    if (all_sizes)
+    {
+        long hits, misses, evictions;
+
+        // only LRU has the inclusion property the sweep relies on
+        if (policy != POLICY_LRU)
         {
-            // walk through cache line elements to find a match of tag id
-            cache_line_ele *tail = cache[set_id]->data;
-            cache_line_ele *match = NULL;
-            while (tail)
-            {
-                if (tail->tag_id == tag_id)
-                    match = tail;
-                if (tail->next == NULL)
-                    break;
-                tail = tail->next;
-            }
-            if (match)
-            {
-                // hit and move the element to the tail
-                hit++;
-                if (mode == 'M')
-                    hit++;
-                if (verbose)
-                {
-                    strcat(buffer, "hit");
-                    if (mode == 'M')
-                        strcat(buffer, " hit");
-                }
-                if (match != tail)
-                {
-                    cache_line_ele *tmp = cache[set_id]->data;
-                    cache_line_ele *prev = NULL;
-                    while (tmp != match)
-                    {
-                        prev = tmp;
-                        tmp = tmp->next;
-                    }
-                    if (prev == NULL)
-                        cache[set_id]->data = match->next;
-                    else
-                        prev->next = match->next;
-                    match->next = NULL;
-                    tail->next = match;
-                }
-            }
-            else
+            printf("-a only supports LRU replacement\n");
+            exit(EXIT_FAILURE);
+        }
+        run_sweep(trace, set_bits, cache_line_num, block_bits, &hits, &misses, &evictions);
+        free(trace_path);
+        trace_close(trace);
+        printSummary(hits, misses, evictions);
+        return 0;
+    }
+    if (hier_mode)
+    {
+        for (int i = 0; i < nlower; i++)
+        {
+            // a block moving between levels must be the same block everywhere
+            if (inclusion == HIER_EXCLUSIVE && lower[i][2] != block_bits)
             {
-                cache_line_ele *new_ele = (cache_line_ele *)malloc(sizeof(cache_line_ele));
-                if (!new_ele)
-                {
-                    fprintf(stderr, "malloc for new cache line element failed\n");
-                    exit(EXIT_FAILURE);
-                }
-                new_ele->tag_id = tag_id;
-                new_ele->next = NULL;
-                if (cache[set_id]->capacity < cache[set_id]->total)
-                {
-                    // no match but there is enough space to add
-                    miss++;
-                    if (mode == 'M')
-                        hit++;
-                    if (verbose)
-                    {
-                        strcat(buffer, "miss");
-                        if (mode == 'M')
-                            strcat(buffer, " hit");
-                    }
-                    tail->next = new_ele;
-                    cache[set_id]->capacity++;
-                }
-                else
-                {
-                    // eviction
-                    miss++;
-                    eviction++;
-                    if (mode == 'M')
-                        hit++;
-                    if (verbose)
-                    {
-                        strcat(buffer, "miss eviction");
-                        if (mode == 'M')
-                            strcat(buffer, " hit");
-                    }
-                    cache_line_ele *head = cache[set_id]->data;
-                    if (head == tail)
-                    {
-                        free(head);
-                        cache[set_id]->data = new_ele;
-                    }
-                    else
-                    {
-                        cache[set_id]->data = head->next;
-                        free(head);
-                        tail->next = new_ele;
-                    }
-                }
+                printf("An exclusive hierarchy needs the same b at every level\n");
+                exit(EXIT_FAILURE);
             }
         }
-        if (verbose)
-            printf("%s\n", buffer);
+        hier_t *hier = hier_new(inclusion, write_through, mem_latency);
+        int failed = !hier || hier_add_level(hier, set_bits, cache_line_num, block_bits,
+                                             l1_latency) < 0;
+        for (int i = 0; !failed && i < nlower; i++)
+            failed = hier_add_level(hier, lower[i][0], lower[i][1], lower[i][2], lower[i][3]) < 0;
+        for (int i = 0; !failed && i < hier->nlevels; i++)
+            failed = cache_set_policy(hier->level[i].cache, policy) < 0;
+        if (failed)
+        {
+            printf("malloc of cache failed.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        run_hierarchy(trace, hier);
+        free(trace_path);
+        trace_close(trace);
+        printSummary(hier->level[0].cache->hits, hier->level[0].cache->misses,
+                     hier->level[0].cache->evictions);
+        hier_free(hier);
+        return 0;
     }
+    if (nthreads > 1)
+    {
+        long hits, misses, evictions;
 
-    // clean up
-    free(trace_path);
-    for (int i = 0; i < set_num; i++)
+        if (parallel_simulate(trace, set_bits, cache_line_num, block_bits, policy, nthreads,
+                              verbose || attrib || classify ? report_access : NULL, &hits, &misses,
+                              &evictions) < 0)
+        {
+            fprintf(stderr, "cannot start %d simulation threads\n", nthreads);
+            exit(EXIT_FAILURE);
+        }
+        free(trace_path);
+        trace_close(trace);
+        if (attrib)
+        {
+            attrib_print(attrib, stdout);
+            attrib_free(attrib);
+        }
+        if (classify)
+        {
+            print_classes();
+            classify_free(classify);
+        }
+        printSummary(hits, misses, evictions);
+        return 0;
+    }
+
+    // init cache
+    cache_t *cache = cache_new(set_bits, cache_line_num, block_bits);
+    if (!cache || cache_set_policy(cache, policy) < 0)
     {
-        cache_line_ele *ptr = cache[i]->data;
-        while (ptr)
+        printf("malloc of cache failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (sample)
+    {
+        long estimate[3];
+
+        run_sampled(trace, cache, sample, estimate);
+        free(trace_path);
+        trace_close(trace);
+        sample_free(sample);
+        printSummary(estimate[0], estimate[1], estimate[2]);
+        cache_free(cache);
+        return 0;
+    }
+    prefetch_t *prefetch = NULL;
+    if (prefetching)
+    {
+        prefetch = prefetch_new(cache, prefetch_kind, prefetch_degree, prefetch_latency);
+        if (!prefetch)
         {
-            cache_line_ele *next = ptr->next;
-            free(ptr);
-            ptr = next;
+            printf("malloc of prefetcher failed.\n");
+            exit(EXIT_FAILURE);
         }
-        free(cache[i]);
     }
-    free(cache);
-    fclose(trace_file);
-    printSummary(hit, miss, eviction);
+
+    // scan trace file
+    trace_access_t access;
+    while (trace_next(trace, &access))
+    {
+        cache_result_t result = prefetch ? prefetch_access(prefetch, access.addr)
+                                         : cache_access(cache, access.addr);
+        // the store of a modify always hits the line the load brought in
+        if (access.op == 'M')
+            cache_access(cache, access.addr);
+        report_access(&access, result);
+    }
+
+    // clean up
+    free(trace_path);
+    trace_close(trace);
+    if (attrib)
+    {
+        attrib_print(attrib, stdout);
+        attrib_free(attrib);
+    }
+    if (classify)
+    {
+        print_classes();
+        classify_free(classify);
+    }
+    if (prefetch)
+    {
+        long issued, useful, late, useless, evictions;
+
+        prefetch_finish(prefetch);
+        prefetch_counts(prefetch, &issued, &useful, &late, &useless, &evictions);
+        printf("prefetches: issued:%ld useful:%ld late:%ld useless:%ld evictions:%ld\n", issued,
+               useful, late, useless, evictions);
+        prefetch_free(prefetch);
+    }
+    printSummary(cache->hits, cache->misses, cache->evictions);
+    cache_free(cache);
     return 0;
 }
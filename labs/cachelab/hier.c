@@ -0,0 +1,167 @@
+/*
+ * hier.c - A multi-level cache hierarchy built from cache.c levels
+ *
+ * A demand access looks up L1, L2, ... in turn until one hits, and
+ * every lookup is counted in that level's cache_t. What happens to
+ * the block afterwards depends on the inclusion policy:
+ *
+ * - non-inclusive (NINE) and inclusive: the block is filled into every
+ *   level that missed, lowest first. An inclusive level that evicts a
+ *   block also invalidates it in all levels above it.
+ * - exclusive: the block moves from the level that hit (or memory)
+ *   straight into L1, and every victim moves one level down.
+ *
+ * With write-back, stores only dirty the L1 line and dirty victims are
+ * written to the next level down (or memory). With write-through,
+ * every store goes to memory and a store miss allocates nothing.
+ *
+ * Lower levels may use bigger blocks than the levels above them; an
+ * inclusive eviction then invalidates every small block it covers.
+ * Exclusive hierarchies need the same block size at every level.
+ */
+#include <stdlib.h>
+
+#include "hier.h"
+
+static void put_block(hier_t *hier, int lvl, uint64_t addr, int dirty);
+
+hier_t *hier_new(inclusion_t inclusion, int write_through, int mem_latency)
+{
+    hier_t *hier = (hier_t *)calloc(1, sizeof(hier_t));
+
+    if (!hier)
+        return NULL;
+    hier->inclusion = inclusion;
+    hier->write_through = write_through;
+    hier->mem_latency = mem_latency;
+    return hier;
+}
+
+int hier_add_level(hier_t *hier, int set_bits, int lines, int block_bits, int latency)
+{
+    level_t *level;
+
+    if (hier->nlevels == HIER_MAX_LEVELS)
+        return -1;
+    level = &hier->level[hier->nlevels];
+    if ((level->cache = cache_new(set_bits, lines, block_bits)) == NULL)
+        return -1;
+    level->latency = latency;
+    hier->nlevels++;
+    return 0;
+}
+
+void hier_free(hier_t *hier)
+{
+    if (!hier)
+        return;
+    for (int i = 0; i < hier->nlevels; i++)
+        cache_free(hier->level[i].cache);
+    free(hier);
+}
+
+/*
+ * evicted - Level lvl just evicted the block at addr: keep the levels
+ *     above inclusive and send the block (or its dirty data) down
+ */
+static void evicted(hier_t *hier, int lvl, uint64_t addr, int dirty)
+{
+    if (hier->inclusion == HIER_INCLUSIVE)
+    {
+        uint64_t size = (uint64_t)1 << hier->level[lvl].cache->block_bits;
+
+        for (int i = 0; i < lvl; i++)
+        {
+            cache_t *above = hier->level[i].cache;
+            uint64_t step = (uint64_t)1 << above->block_bits;
+
+            for (uint64_t a = addr; a < addr + size; a += step)
+            {
+                int d = cache_remove(above, a);
+                if (d >= 0)
+                {
+                    hier->level[i].back_invalidations++;
+                    dirty |= d;
+                }
+            }
+        }
+    }
+
+    if (dirty)
+        hier->level[lvl].writebacks++;
+    if (hier->inclusion == HIER_EXCLUSIVE || dirty)
+        put_block(hier, lvl + 1, addr, dirty);
+}
+
+/*
+ * put_block - Fill the block at addr into level lvl (memory if lvl is
+ *     past the last level) without counting a lookup
+ */
+static void put_block(hier_t *hier, int lvl, uint64_t addr, int dirty)
+{
+    cache_t *cache;
+
+    if (lvl == hier->nlevels)
+    {
+        if (dirty)
+            hier->mem_writes++;
+        return;
+    }
+    cache = hier->level[lvl].cache;
+    if (cache_fill(cache, addr, dirty))
+        evicted(hier, lvl, cache->victim, cache->victim_dirty);
+}
+
+void hier_access(hier_t *hier, uint64_t addr, int write)
+{
+    int lvl, dirty = 0;
+
+    if (write && hier->write_through)
+    {
+        // no-write-allocate: update L1 if the block is there, and memory
+        cache_lookup(hier->level[0].cache, addr, 0);
+        hier->mem_writes++;
+        return;
+    }
+
+    for (lvl = 0; lvl < hier->nlevels; lvl++)
+    {
+        if (cache_lookup(hier->level[lvl].cache, addr, write && lvl == 0))
+            break;
+    }
+    if (lvl == 0)
+        return;
+    if (lvl == hier->nlevels)
+        hier->mem_reads++;
+
+    if (hier->inclusion == HIER_EXCLUSIVE)
+    {
+        // move the block up from where it was found
+        if (lvl < hier->nlevels)
+            dirty = cache_remove(hier->level[lvl].cache, addr);
+        put_block(hier, 0, addr, dirty | write);
+        return;
+    }
+
+    // fill the levels that missed, lowest first, so that an inclusive
+    // eviction below cannot undo the fill above
+    while (--lvl >= 0)
+        put_block(hier, lvl, addr, write && lvl == 0);
+}
+
+/*
+ * hier_amat - Lookups cost the latency of their level and fetches from
+ *     memory mem_latency; stores to memory are assumed to be buffered
+ */
+double hier_amat(const hier_t *hier)
+{
+    double cycles = (double)hier->mem_reads * hier->mem_latency;
+    long l1 = hier->level[0].cache->hits + hier->level[0].cache->misses;
+
+    for (int i = 0; i < hier->nlevels; i++)
+    {
+        const cache_t *cache = hier->level[i].cache;
+        cycles += (double)(cache->hits + cache->misses) * hier->level[i].latency;
+    }
+    return l1 ? cycles / l1 : 0.0;
+}
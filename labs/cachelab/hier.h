@@ -0,0 +1,51 @@
+/*
+ * hier.h - A multi-level cache hierarchy built from cache.c levels
+ */
+#ifndef HIER_H
+#define HIER_H
+
+#include "cache.h"
+
+#define HIER_MAX_LEVELS 8
+
+/* How the contents of the levels relate to each other */
+typedef enum
+{
+    HIER_NINE,      /* neither inclusive nor exclusive: fills go to every level */
+    HIER_INCLUSIVE, /* a lower level evicting a block drops it from the levels above */
+    HIER_EXCLUSIVE  /* a block lives in one level; L1 victims move down */
+} inclusion_t;
+
+typedef struct
+{
+    cache_t *cache;
+    int latency;             /* cycles for a lookup in this level */
+    long writebacks;         /* dirty blocks written to the level below */
+    long back_invalidations; /* lines dropped to keep the hierarchy inclusive */
+} level_t;
+
+typedef struct
+{
+    int nlevels;
+    level_t level[HIER_MAX_LEVELS];
+    inclusion_t inclusion;
+    int write_through; /* write-through, no-write-allocate instead of write-back */
+    int mem_latency;
+    long mem_reads;  /* blocks fetched from memory */
+    long mem_writes; /* blocks (write-back) or stores (write-through) sent to memory */
+} hier_t;
+
+hier_t *hier_new(inclusion_t inclusion, int write_through, int mem_latency);
+
+/* Add the next level below the existing ones; returns -1 on failure */
+int hier_add_level(hier_t *hier, int set_bits, int lines, int block_bits, int latency);
+
+void hier_free(hier_t *hier);
+
+/* Load (write = 0) or store (write = 1) the byte at addr */
+void hier_access(hier_t *hier, uint64_t addr, int write);
+
+/* Average memory access time in cycles over all L1 lookups */
+double hier_amat(const hier_t *hier);
+
+#endif /* HIER_H */
@@ -0,0 +1,255 @@
+/*
+ * kernels.c - Cache-blocked numerical kernels
+ *
+ * Each kernel works on n x n matrices of doubles and has a prototype
+ * of the form:
+ * void kernel(int n, double A[n][n], double B[n][n], double C[n][n]);
+ *
+ * What it computes depends on its kind (see kernel_kind_t in
+ * cachelab.h). test-kernels checks every registered kernel against a
+ * reference, counts its misses on a cache model and times it.
+ *
+ * The Makefile builds this file twice: with -O2 for timing, and with
+ * -DKERNELS_RECORDED and the hooks of record.h for counting misses.
+ * The second build registers the same kernels under other names.
+ */
+#include "cachelab.h"
+
+#ifdef KERNELS_RECORDED
+#define registerKernels registerKernelsRecorded
+#define registerKernelFunction registerRecordedKernel
+#endif
+
+void registerKernels();
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* Columns of a strip of stencil_strips */
+#define STENCIL_STRIP 16
+
+/* Side of the tiles of inplace_blocked */
+#define INPLACE_TILE 8
+
+/*
+ * gemm_ijk - The textbook loop order: B is walked down its columns
+ */
+static char gemm_ijk_desc[] = "GEMM, ijk loops";
+static void gemm_ijk(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i, j, k;
+    double sum;
+
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            sum = C[i][j];
+            for (k = 0; k < n; k++)
+                sum += A[i][k] * B[k][j];
+            C[i][j] = sum;
+        }
+    }
+}
+
+/*
+ * gemm_ikj - Loops interchanged so that B and C are walked along rows
+ */
+static char gemm_ikj_desc[] = "GEMM, ikj loops";
+static void gemm_ikj(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i, j, k;
+    double a;
+
+    for (i = 0; i < n; i++)
+    {
+        for (k = 0; k < n; k++)
+        {
+            a = A[i][k];
+            for (j = 0; j < n; j++)
+                C[i][j] += a * B[k][j];
+        }
+    }
+}
+
+/*
+ * gemm_tiled - C += A * B one t x t tile of each at a time, ikj inside
+ *     a tile, so the three tiles stay cached while they are reused
+ */
+static void gemm_tiled(int n, double A[n][n], double B[n][n], double C[n][n], int t)
+{
+    int i0, j0, k0, i, j, k;
+    double a;
+
+    for (i0 = 0; i0 < n; i0 += t)
+    {
+        for (k0 = 0; k0 < n; k0 += t)
+        {
+            for (j0 = 0; j0 < n; j0 += t)
+            {
+                for (i = i0; i < MIN(i0 + t, n); i++)
+                {
+                    for (k = k0; k < MIN(k0 + t, n); k++)
+                    {
+                        a = A[i][k];
+                        for (j = j0; j < MIN(j0 + t, n); j++)
+                            C[i][j] += a * B[k][j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Three 8x8 tiles take 1.5KB, a small part of an L1 cache, so they
+   survive the conflicts between the tiles of A, B and C */
+static char gemm_tiled_8_desc[] = "GEMM, 8x8 tiles";
+static void gemm_tiled_8(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    gemm_tiled(n, A, B, C, 8);
+}
+
+/* Three 32x32 tiles (24KB) fit a typical 32KB L1 data cache */
+static char gemm_tiled_32_desc[] = "GEMM, 32x32 tiles";
+static void gemm_tiled_32(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    gemm_tiled(n, A, B, C, 32);
+}
+
+/*
+ * stencil_point - One point of the Jacobi step; every stencil kernel
+ *     uses it, so all of them compute bit-identical results
+ */
+static inline double stencil_point(int n, double A[n][n], int i, int j)
+{
+    return 0.2 * (A[i][j] + A[i - 1][j] + A[i + 1][j] + A[i][j - 1] + A[i][j + 1]);
+}
+
+/*
+ * stencil_border - Copy the border of A, which the step leaves alone
+ */
+static void stencil_border(int n, double A[n][n], double B[n][n])
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        B[0][i] = A[0][i];
+        B[n - 1][i] = A[n - 1][i];
+        B[i][0] = A[i][0];
+        B[i][n - 1] = A[i][n - 1];
+    }
+}
+
+/*
+ * stencil_rows - Row by row: three rows of A are live at a time
+ */
+static char stencil_rows_desc[] = "Stencil, row order";
+static void stencil_rows(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i, j;
+
+    stencil_border(n, A, B);
+    for (i = 1; i < n - 1; i++)
+        for (j = 1; j < n - 1; j++)
+            B[i][j] = stencil_point(n, A, i, j);
+}
+
+/*
+ * stencil_columns - Column by column, the order to avoid
+ */
+static char stencil_columns_desc[] = "Stencil, column order";
+static void stencil_columns(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i, j;
+
+    stencil_border(n, A, B);
+    for (j = 1; j < n - 1; j++)
+        for (i = 1; i < n - 1; i++)
+            B[i][j] = stencil_point(n, A, i, j);
+}
+
+/*
+ * stencil_strips - Row by row within strips of STENCIL_STRIP columns,
+ *     so that three rows of a strip stay cached when three whole rows
+ *     would not
+ */
+static char stencil_strips_desc[] = "Stencil, column strips";
+static void stencil_strips(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i, j, j0;
+
+    stencil_border(n, A, B);
+    for (j0 = 1; j0 < n - 1; j0 += STENCIL_STRIP)
+        for (i = 1; i < n - 1; i++)
+            for (j = j0; j < MIN(j0 + STENCIL_STRIP, n - 1); j++)
+                B[i][j] = stencil_point(n, A, i, j);
+}
+
+/*
+ * inplace_naive - Swap each element above the diagonal with its mirror
+ */
+static char inplace_naive_desc[] = "In-place transpose, element swaps";
+static void inplace_naive(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i, j;
+    double tmp;
+
+    for (i = 0; i < n; i++)
+    {
+        for (j = i + 1; j < n; j++)
+        {
+            tmp = A[i][j];
+            A[i][j] = A[j][i];
+            A[j][i] = tmp;
+        }
+    }
+}
+
+/*
+ * inplace_blocked - Swap each tile above the diagonal with its mirror
+ *     tile, transposing both; tiles on the diagonal are transposed in
+ *     place
+ */
+static char inplace_blocked_desc[] = "In-place transpose, 8x8 tile swaps";
+static void inplace_blocked(int n, double A[n][n], double B[n][n], double C[n][n])
+{
+    int i0, j0, i, j;
+    double tmp;
+
+    for (i0 = 0; i0 < n; i0 += INPLACE_TILE)
+    {
+        for (j0 = i0; j0 < n; j0 += INPLACE_TILE)
+        {
+            for (i = i0; i < MIN(i0 + INPLACE_TILE, n); i++)
+            {
+                // on the diagonal, only the upper triangle of the tile
+                for (j = j0 == i0 ? i + 1 : j0; j < MIN(j0 + INPLACE_TILE, n); j++)
+                {
+                    tmp = A[i][j];
+                    A[i][j] = A[j][i];
+                    A[j][i] = tmp;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * registerKernels - Register the kernels with test-kernels, which
+ *     evaluates each of them. Kernels of a kind are listed together,
+ *     the simplest first.
+ */
+void registerKernels()
+{
+    registerKernelFunction(KERNEL_GEMM, gemm_ijk, gemm_ijk_desc);
+    registerKernelFunction(KERNEL_GEMM, gemm_ikj, gemm_ikj_desc);
+    registerKernelFunction(KERNEL_GEMM, gemm_tiled_8, gemm_tiled_8_desc);
+    registerKernelFunction(KERNEL_GEMM, gemm_tiled_32, gemm_tiled_32_desc);
+
+    registerKernelFunction(KERNEL_STENCIL, stencil_rows, stencil_rows_desc);
+    registerKernelFunction(KERNEL_STENCIL, stencil_columns, stencil_columns_desc);
+    registerKernelFunction(KERNEL_STENCIL, stencil_strips, stencil_strips_desc);
+
+    registerKernelFunction(KERNEL_INPLACE, inplace_naive, inplace_naive_desc);
+    registerKernelFunction(KERNEL_INPLACE, inplace_blocked, inplace_blocked_desc);
+}
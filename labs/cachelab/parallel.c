@@ -0,0 +1,242 @@
+/*
+ * parallel.c - Multithreaded simulation of one cache, sharded by set
+ *
+ * Sets never interact, so each worker thread owns the sets with
+ * set_id % nthreads == its id and simulates them in its own cache_t.
+ * (Each worker allocates the full cache, but only the pages of its
+ * own sets are ever touched. The random and BRRIP policies draw from
+ * one generator per worker, so their results vary with nthreads.)
+ *
+ * The calling thread reads the trace in chunks and routes every access
+ * to the list of the worker owning its set. Two chunks are in flight:
+ * while the workers simulate one, the reader decodes the next. Once a
+ * chunk is done, its results are reported in trace order, so verbose
+ * output is the same as with a single thread.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+#define CHUNK 65536 /* accesses per chunk */
+
+typedef struct
+{
+    trace_access_t *access; /* CHUNK accesses in trace order */
+    unsigned char *result;  /* cache_result_t of each access */
+    int *index;             /* for each worker, CHUNK slots of indices into access */
+    int *count;             /* number of indices in each worker's list */
+    char *text;             /* streams: copies of the lines of the accesses */
+    size_t text_size;
+    int n;                  /* accesses in this chunk; 0 ends the trace */
+} chunk_t;
+
+typedef struct sim sim_t;
+
+typedef struct
+{
+    pthread_t tid;
+    int id;
+    cache_t *cache;
+    sim_t *sim;
+} worker_t;
+
+struct sim
+{
+    int nthreads;
+    int set_bits, block_bits;
+    chunk_t chunks[2];
+    worker_t *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;    /* a new chunk was published */
+    pthread_cond_t finished; /* all workers are done with the current chunk */
+    long published;          /* number of chunks handed to the workers */
+    int done;                /* workers done with the current chunk */
+};
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    sim_t *sim = w->sim;
+
+    for (long gen = 0;; gen++)
+    {
+        pthread_mutex_lock(&sim->lock);
+        while (sim->published <= gen)
+            pthread_cond_wait(&sim->ready, &sim->lock);
+        pthread_mutex_unlock(&sim->lock);
+
+        chunk_t *c = &sim->chunks[gen % 2];
+        if (c->n == 0)
+            return NULL;
+        const int *index = c->index + (size_t)w->id * CHUNK;
+        for (int k = 0; k < c->count[w->id]; k++)
+        {
+            const trace_access_t *a = &c->access[index[k]];
+            c->result[index[k]] = (unsigned char)cache_access(w->cache, a->addr);
+            if (a->op == 'M')
+                cache_access(w->cache, a->addr);
+        }
+
+        pthread_mutex_lock(&sim->lock);
+        if (++sim->done == sim->nthreads)
+            pthread_cond_signal(&sim->finished);
+        pthread_mutex_unlock(&sim->lock);
+    }
+}
+
+/*
+ * fill_chunk - Read the next CHUNK accesses and route them to the workers
+ */
+static void fill_chunk(sim_t *sim, trace_t *trace, chunk_t *c)
+{
+    uint64_t set_mask = ((uint64_t)1 << sim->set_bits) - 1;
+    int stream = trace_is_stream(trace);
+    size_t used = 0;
+    int i;
+
+    for (i = 0; i < sim->nthreads; i++)
+        c->count[i] = 0;
+    for (i = 0; i < CHUNK && trace_next(trace, &c->access[i]); i++)
+    {
+        uint64_t set_id = (c->access[i].addr >> sim->block_bits) & set_mask;
+        int w = (int)(set_id % sim->nthreads);
+        c->index[(size_t)w * CHUNK + c->count[w]++] = i;
+
+        // a streamed line is gone after the next read: keep a copy
+        if (stream && c->access[i].line)
+        {
+            size_t len = c->access[i].len;
+            if (used + len > c->text_size)
+            {
+                size_t size = 2 * (used + len);
+                char *text = (char *)realloc(c->text, size);
+                if (!text)
+                    abort();
+                c->text = text;
+                c->text_size = size;
+            }
+            memcpy(c->text + used, c->access[i].line, len);
+            // store the offset + 1 until the text stops moving
+            c->access[i].line = (const char *)(uintptr_t)(used + 1);
+            used += len;
+        }
+    }
+    c->n = i;
+    for (i = 0; stream && i < c->n; i++)
+    {
+        if (c->access[i].line)
+            c->access[i].line = c->text + (uintptr_t)c->access[i].line - 1;
+    }
+}
+
+static void free_sim(sim_t *sim)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        free(sim->chunks[i].access);
+        free(sim->chunks[i].result);
+        free(sim->chunks[i].index);
+        free(sim->chunks[i].count);
+        free(sim->chunks[i].text);
+    }
+    for (int i = 0; i < sim->nthreads; i++)
+        cache_free(sim->workers[i].cache);
+    free(sim->workers);
+}
+
+int parallel_simulate(trace_t *trace, int set_bits, int lines, int block_bits,
+                      cache_policy_t policy, int nthreads, report_fn_t report, long *hits,
+                      long *misses, long *evictions)
+{
+    sim_t sim = {0};
+    int i, started = 0, ok = 1;
+
+    sim.nthreads = nthreads;
+    sim.set_bits = set_bits;
+    sim.block_bits = block_bits;
+    sim.workers = (worker_t *)calloc(nthreads, sizeof(worker_t));
+    if (!sim.workers)
+        return -1;
+    for (i = 0; i < 2; i++)
+    {
+        chunk_t *c = &sim.chunks[i];
+        c->access = (trace_access_t *)malloc(CHUNK * sizeof(trace_access_t));
+        c->result = (unsigned char *)malloc(CHUNK);
+        c->index = (int *)malloc((size_t)nthreads * CHUNK * sizeof(int));
+        c->count = (int *)calloc(nthreads, sizeof(int));
+        ok = ok && c->access && c->result && c->index && c->count;
+    }
+    for (i = 0; ok && i < nthreads; i++)
+    {
+        sim.workers[i].id = i;
+        sim.workers[i].sim = &sim;
+        sim.workers[i].cache = cache_new(set_bits, lines, block_bits);
+        ok = sim.workers[i].cache != NULL && cache_set_policy(sim.workers[i].cache, policy) == 0;
+    }
+    if (!ok)
+    {
+        free_sim(&sim);
+        return -1;
+    }
+
+    pthread_mutex_init(&sim.lock, NULL);
+    pthread_cond_init(&sim.ready, NULL);
+    pthread_cond_init(&sim.finished, NULL);
+    for (; started < nthreads; started++)
+    {
+        if (pthread_create(&sim.workers[started].tid, NULL, worker_main, &sim.workers[started]))
+            break;
+    }
+    // without all workers, some sets would never be simulated: just end the run
+    if (started < nthreads)
+        ok = 0;
+
+    fill_chunk(&sim, trace, &sim.chunks[0]);
+    for (long gen = 0;; gen++)
+    {
+        chunk_t *c = &sim.chunks[gen % 2];
+
+        if (!ok)
+            c->n = 0;
+        pthread_mutex_lock(&sim.lock);
+        sim.done = 0;
+        sim.published = gen + 1;
+        pthread_cond_broadcast(&sim.ready);
+        pthread_mutex_unlock(&sim.lock);
+        if (c->n == 0)
+            break;
+
+        // decode the next chunk while the workers simulate this one
+        fill_chunk(&sim, trace, &sim.chunks[(gen + 1) % 2]);
+
+        pthread_mutex_lock(&sim.lock);
+        while (sim.done < nthreads)
+            pthread_cond_wait(&sim.finished, &sim.lock);
+        pthread_mutex_unlock(&sim.lock);
+
+        if (report)
+        {
+            for (i = 0; i < c->n; i++)
+                report(&c->access[i], (cache_result_t)c->result[i]);
+        }
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(sim.workers[i].tid, NULL);
+
+    *hits = *misses = *evictions = 0;
+    for (i = 0; i < nthreads; i++)
+    {
+        *hits += sim.workers[i].cache->hits;
+        *misses += sim.workers[i].cache->misses;
+        *evictions += sim.workers[i].cache->evictions;
+    }
+    pthread_mutex_destroy(&sim.lock);
+    pthread_cond_destroy(&sim.ready);
+    pthread_cond_destroy(&sim.finished);
+    free_sim(&sim);
+    return ok ? 0 : -1;
+}
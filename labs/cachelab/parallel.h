@@ -0,0 +1,23 @@
+/*
+ * parallel.h - Multithreaded simulation of one cache, sharded by set
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "cache.h"
+#include "trace.h"
+
+/* Called for every access, in trace order, with the outcome of its load or store */
+typedef void (*report_fn_t)(const trace_access_t *access, cache_result_t result);
+
+/*
+ * Replay trace on a cache with 2^set_bits sets of lines lines and the
+ * given replacement policy using nthreads workers, and return the
+ * summed counts. report may be NULL.
+ * Returns -1 if the threads or buffers cannot be set up.
+ */
+int parallel_simulate(trace_t *trace, int set_bits, int lines, int block_bits,
+                      cache_policy_t policy, int nthreads, report_fn_t report, long *hits,
+                      long *misses, long *evictions);
+
+#endif /* PARALLEL_H */
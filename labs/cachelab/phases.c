@@ -0,0 +1,329 @@
+/*
+ * phases.c - Picks representative intervals of a trace for csim -S
+ *
+ * In the spirit of SimPoint, the trace is cut into intervals of a
+ * fixed number of accesses, and each interval is summarized by a
+ * signature: the share of its accesses that falls in each of
+ * PHASE_DIMS buckets of 4KB pages (the traces have no basic blocks, so
+ * the pages touched stand in for the code run). The signatures are
+ * clustered with k-means for every k up to a maximum, and the smallest
+ * k that gets within 10% of the best fit is kept, as SimPoint does
+ * with its BIC score.
+ *
+ * From every cluster the interval nearest its centre is picked, plus a
+ * few more at random so that csim can tell how much the cluster
+ * varies. The points file lists them with their cluster and the share
+ * of the trace the cluster covers; csim -S reads it.
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define PHASE_DIMS 64
+#define PAGE_BITS 12
+#define KMEANS_ITERS 100
+
+/* Keep the smallest k whose fit is this close to the best one */
+#define FIT_TOLERANCE 0.1
+
+static const char *help_msg = "Usage: ./phases [-h] [-i <n>] [-k <n>] [-n <n>] [-o <file>] -t <tracefile>\n"
+                              "   -h: Optional help flag that prints usage info\n"
+                              "   -i: <n>: Accesses per interval (default 100000)\n"
+                              "   -k: <n>: Largest number of clusters to try (default 10)\n"
+                              "   -n: <n>: Intervals to pick from each cluster (default 3)\n"
+                              "   -o: <file>: Write the points there instead of stdout\n"
+                              "   -t: <tracefile>: Name of the valgrind trace to split\n";
+
+static uint64_t rng_state;
+
+static uint64_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double distance2(const float *a, const float *b)
+{
+    double d = 0;
+
+    for (int i = 0; i < PHASE_DIMS; i++)
+        d += (double)(a[i] - b[i]) * (a[i] - b[i]);
+    return d;
+}
+
+/*
+ * read_signatures - Read the trace and return the signature of every
+ *     complete interval, PHASE_DIMS floats each; sets *n to their number,
+ *     or returns NULL with *n set to -1 if it runs out of memory
+ */
+static float *read_signatures(trace_t *trace, long interval, long *n)
+{
+    float *sig = NULL;
+    long count = 0, max = 0, pos = 0;
+    long hist[PHASE_DIMS] = {0};
+    trace_access_t access;
+
+    *n = 0;
+    while (trace_next(trace, &access))
+    {
+        uint64_t page = access.addr >> PAGE_BITS;
+        hist[((page * 0x9E3779B97F4A7C15ULL) >> 32) % PHASE_DIMS]++;
+        if (++pos < interval)
+            continue;
+
+        if (count == max)
+        {
+            max = max ? 2 * max : 256;
+            float *more = (float *)realloc(sig, max * PHASE_DIMS * sizeof(float));
+            if (!more)
+            {
+                free(sig);
+                *n = -1;
+                return NULL;
+            }
+            sig = more;
+        }
+        for (int i = 0; i < PHASE_DIMS; i++)
+            sig[count * PHASE_DIMS + i] = (float)hist[i] / interval;
+        memset(hist, 0, sizeof(hist));
+        pos = 0;
+        count++;
+    }
+    *n = count;
+    return sig;
+}
+
+/*
+ * kmeans - Cluster the n signatures into k, seeded k-means++ style;
+ *     fills assign and centre and returns the sum of the squared
+ *     distances of the signatures to their centres
+ */
+static double kmeans(const float *sig, long n, int k, int *assign, float *centre)
+{
+    double *d2 = (double *)malloc(n * sizeof(double));
+    long *size = (long *)malloc(k * sizeof(long));
+    double sse = 0;
+    int changed = 1;
+
+    if (!d2 || !size)
+    {
+        fprintf(stderr, "out of memory clustering %ld intervals\n", n);
+        exit(EXIT_FAILURE);
+    }
+
+    // k-means++: each further centre is drawn with odds d^2 to the nearest one
+    rng_state = 0x2545F4914F6CDD1DULL + k;
+    memcpy(centre, sig + next_random() % n * PHASE_DIMS, PHASE_DIMS * sizeof(float));
+    for (int c = 1; c < k; c++)
+    {
+        double total = 0, r;
+        long pick = n - 1;
+
+        for (long i = 0; i < n; i++)
+        {
+            d2[i] = INFINITY;
+            for (int j = 0; j < c; j++)
+                d2[i] = fmin(d2[i], distance2(sig + i * PHASE_DIMS, centre + j * PHASE_DIMS));
+            total += d2[i];
+        }
+        r = (double)(next_random() >> 11) / (1ULL << 53) * total;
+        for (long i = 0; i < n; i++)
+        {
+            if ((r -= d2[i]) < 0)
+            {
+                pick = i;
+                break;
+            }
+        }
+        memcpy(centre + c * PHASE_DIMS, sig + pick * PHASE_DIMS, PHASE_DIMS * sizeof(float));
+    }
+
+    for (long i = 0; i < n; i++)
+        assign[i] = -1;
+    for (int iter = 0; iter < KMEANS_ITERS && changed; iter++)
+    {
+        changed = 0;
+        sse = 0;
+        for (long i = 0; i < n; i++)
+        {
+            int best = 0;
+            double best_d = distance2(sig + i * PHASE_DIMS, centre);
+
+            for (int c = 1; c < k; c++)
+            {
+                double d = distance2(sig + i * PHASE_DIMS, centre + c * PHASE_DIMS);
+                if (d < best_d)
+                {
+                    best_d = d;
+                    best = c;
+                }
+            }
+            changed |= assign[i] != best;
+            assign[i] = best;
+            sse += best_d;
+        }
+
+        // move every centre to the mean of its signatures; an empty one stays
+        memset(size, 0, k * sizeof(long));
+        for (long i = 0; i < n; i++)
+            size[assign[i]]++;
+        for (int c = 0; c < k; c++)
+            if (size[c])
+                memset(centre + c * PHASE_DIMS, 0, PHASE_DIMS * sizeof(float));
+        for (long i = 0; i < n; i++)
+            for (int j = 0; j < PHASE_DIMS; j++)
+                centre[assign[i] * PHASE_DIMS + j] += sig[i * PHASE_DIMS + j] / size[assign[i]];
+    }
+    free(d2);
+    free(size);
+    return sse;
+}
+
+/*
+ * write_points - Write the picks of every non-empty cluster: the
+ *     interval nearest its centre, then up to per_cluster - 1 others
+ *     at random
+ */
+static void write_points(FILE *out, const float *sig, long n, int k, const int *assign,
+                         const float *centre, long interval, int per_cluster)
+{
+    long *members = (long *)malloc(n * sizeof(long));
+
+    if (!members)
+    {
+        fprintf(stderr, "out of memory picking intervals\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(out, "# phases: %ld intervals of %ld accesses in %d clusters\n", n, interval, k);
+    fprintf(out, "interval %ld\n", interval);
+    for (int c = 0; c < k; c++)
+    {
+        long m = 0, nearest = 0, picks;
+
+        for (long i = 0; i < n; i++)
+            if (assign[i] == c)
+                members[m++] = i;
+        if (!m)
+            continue;
+        for (long j = 1; j < m; j++)
+            if (distance2(sig + members[j] * PHASE_DIMS, centre + c * PHASE_DIMS) <
+                distance2(sig + members[nearest] * PHASE_DIMS, centre + c * PHASE_DIMS))
+                nearest = j;
+
+        // the nearest first, then a partial shuffle of the rest
+        long tmp = members[0];
+        members[0] = members[nearest];
+        members[nearest] = tmp;
+        picks = m < per_cluster ? m : per_cluster;
+        for (long j = 1; j < picks; j++)
+        {
+            long r = j + (long)(next_random() % (uint64_t)(m - j));
+            tmp = members[j];
+            members[j] = members[r];
+            members[r] = tmp;
+        }
+        fprintf(out, "# cluster %d: %ld intervals (%.1f%%)\n", c, m, 100.0 * m / n);
+        for (long j = 0; j < picks; j++)
+            fprintf(out, "%ld %d %.6f\n", members[j], c, (double)m / n);
+    }
+    free(members);
+}
+
+int main(int argc, char **argv)
+{
+    long interval = 100000, n;
+    int max_k = 10, per_cluster = 3, opt, k;
+    char *trace_path = NULL, *out_path = NULL;
+    FILE *out = stdout;
+
+    while ((opt = getopt(argc, argv, "hi:k:n:o:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'h':
+            printf("%s", help_msg);
+            exit(EXIT_SUCCESS);
+        case 'i':
+            interval = atol(optarg);
+            break;
+        case 'k':
+            max_k = atoi(optarg);
+            break;
+        case 'n':
+            per_cluster = atoi(optarg);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 't':
+            trace_path = optarg;
+            break;
+        default:
+            printf("%s", help_msg);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!trace_path || interval <= 0 || max_k <= 0 || per_cluster <= 0)
+    {
+        printf("Missing or invalid command line argument\n%s", help_msg);
+        exit(EXIT_FAILURE);
+    }
+
+    trace_t *trace = trace_open(trace_path);
+    if (!trace)
+    {
+        fprintf(stderr, "cannot open %s for reading\n", trace_path);
+        exit(EXIT_FAILURE);
+    }
+    float *sig = read_signatures(trace, interval, &n);
+    trace_close(trace);
+    if (n < 0)
+    {
+        fprintf(stderr, "out of memory reading %s\n", trace_path);
+        exit(EXIT_FAILURE);
+    }
+    if (!n)
+    {
+        fprintf(stderr, "%s has fewer than %ld accesses\n", trace_path, interval);
+        exit(EXIT_FAILURE);
+    }
+    if (max_k > n)
+        max_k = n;
+
+    int *assign = (int *)malloc(n * sizeof(int));
+    float *centre = (float *)malloc(max_k * PHASE_DIMS * sizeof(float));
+    double *sse = (double *)malloc((max_k + 1) * sizeof(double));
+    if (!sig || !assign || !centre || !sse)
+    {
+        fprintf(stderr, "out of memory clustering %ld intervals\n", n);
+        exit(EXIT_FAILURE);
+    }
+    for (k = 1; k <= max_k; k++)
+        sse[k] = kmeans(sig, n, k, assign, centre);
+    for (k = 1; k < max_k; k++)
+        if (sse[k] <= sse[max_k] + FIT_TOLERANCE * (sse[1] - sse[max_k]))
+            break;
+    kmeans(sig, n, k, assign, centre);
+
+    if (out_path && !(out = fopen(out_path, "w")))
+    {
+        fprintf(stderr, "cannot open %s for writing\n", out_path);
+        exit(EXIT_FAILURE);
+    }
+    write_points(out, sig, n, k, assign, centre, interval, per_cluster);
+    if (out != stdout)
+        fclose(out);
+
+    free(sig);
+    free(assign);
+    free(centre);
+    free(sse);
+    return 0;
+}
@@ -0,0 +1,417 @@
+/*
+ * prefetch.c - Hardware prefetcher models in front of a cache
+ *
+ * Next-line and stride prefetches wait in a small array of MSHRs until
+ * they arrive, and are then filled into the cache. The blocks they
+ * brought in that have not been used yet are kept in an
+ * open-addressing set, so that the first use of one counts as useful
+ * and its eviction as useless; the set never holds more blocks than
+ * the cache. Stream buffers hold their blocks themselves.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+#define DEFAULT_DEGREE 1
+#define DEFAULT_STREAM_DEPTH 4
+#define DEFAULT_LATENCY 10
+#define MAX_DEGREE 16
+
+/* Stride prefetcher: a direct-mapped table of 4KB regions */
+#define STRIDE_REGION_BITS 12
+#define STRIDE_ENTRIES 64
+
+#define STREAM_BUFFERS 4
+
+typedef struct
+{
+    uint64_t block;
+    long ready; /* demand access at which it arrives */
+} inflight_t;
+
+typedef struct
+{
+    int valid;
+    uint64_t region;
+    uint64_t last;  /* address of the last access to the region */
+    int64_t stride; /* between the last two accesses */
+    int confidence; /* times in a row the stride repeated, up to 3 */
+} stride_entry_t;
+
+typedef struct
+{
+    uint64_t block[MAX_DEGREE]; /* a FIFO of degree blocks */
+    long ready[MAX_DEGREE];
+    int head, count;
+    uint64_t next; /* block to fetch next */
+    long used;     /* last demand access that allocated or hit it */
+} stream_t;
+
+struct prefetch
+{
+    cache_t *cache;
+    prefetch_kind_t kind;
+    int degree;
+    int latency;
+    long now; /* demand accesses so far */
+
+    inflight_t mshr[PREFETCH_MSHRS];
+    int ninflight;
+
+    stride_entry_t strides[STRIDE_ENTRIES];
+    stream_t streams[STREAM_BUFFERS];
+
+    /* prefetched blocks not used yet: block + 1, 0 is free */
+    uint64_t *unused;
+    size_t slots;
+    long nunused;
+
+    long issued, useful, late, useless;
+    long evictions; /* made by prefetch fills */
+};
+
+static size_t hash_block(uint64_t block)
+{
+    return (size_t)(block * 0x9E3779B97F4A7C15ULL >> 17);
+}
+
+int prefetch_parse(const char *arg, prefetch_kind_t *kind, int *degree, int *latency)
+{
+    char name[16];
+    int n;
+
+    *degree = 0;
+    *latency = DEFAULT_LATENCY;
+    n = sscanf(arg, "%15[a-z],%d,%d", name, degree, latency);
+    if (n < 1)
+        return -1;
+    if (strcmp(name, "next") == 0)
+        *kind = PREFETCH_NEXT_LINE;
+    else if (strcmp(name, "stride") == 0)
+        *kind = PREFETCH_STRIDE;
+    else if (strcmp(name, "stream") == 0)
+        *kind = PREFETCH_STREAM;
+    else
+        return -1;
+    if (n < 2)
+        *degree = *kind == PREFETCH_STREAM ? DEFAULT_STREAM_DEPTH : DEFAULT_DEGREE;
+    if (*degree < 1 || *degree > MAX_DEGREE || *latency < 0)
+        return -1;
+    return 0;
+}
+
+prefetch_t *prefetch_new(cache_t *cache, prefetch_kind_t kind, int degree, int latency)
+{
+    prefetch_t *prefetch = (prefetch_t *)calloc(1, sizeof(prefetch_t));
+    long lines = (long)cache->lines << cache->set_bits;
+
+    if (!prefetch)
+        return NULL;
+    prefetch->cache = cache;
+    prefetch->kind = kind;
+    prefetch->degree = degree;
+    prefetch->latency = latency;
+    prefetch->slots = 16;
+    while ((long)prefetch->slots < 2 * lines)
+        prefetch->slots *= 2;
+    prefetch->unused = (uint64_t *)calloc(prefetch->slots, sizeof(uint64_t));
+    if (!prefetch->unused)
+    {
+        free(prefetch);
+        return NULL;
+    }
+    return prefetch;
+}
+
+void prefetch_free(prefetch_t *prefetch)
+{
+    if (!prefetch)
+        return;
+    free(prefetch->unused);
+    free(prefetch);
+}
+
+static void unused_add(prefetch_t *prefetch, uint64_t block)
+{
+    size_t mask = prefetch->slots - 1;
+    size_t i = hash_block(block) & mask;
+
+    while (prefetch->unused[i] && prefetch->unused[i] != block + 1)
+        i = (i + 1) & mask;
+    if (!prefetch->unused[i])
+        prefetch->nunused++;
+    prefetch->unused[i] = block + 1;
+}
+
+/*
+ * unused_remove - Drop block from the unused set; returns 1 if it was
+ *     there. The entries after it move back into the hole, so lookups
+ *     never need tombstones.
+ */
+static int unused_remove(prefetch_t *prefetch, uint64_t block)
+{
+    size_t mask = prefetch->slots - 1;
+    size_t i = hash_block(block) & mask, j, home;
+
+    while (prefetch->unused[i] && prefetch->unused[i] != block + 1)
+        i = (i + 1) & mask;
+    if (!prefetch->unused[i])
+        return 0;
+    for (j = (i + 1) & mask; prefetch->unused[j]; j = (j + 1) & mask)
+    {
+        home = hash_block(prefetch->unused[j] - 1) & mask;
+        // an entry whose home lies in (i, j] is still reachable
+        if (i <= j ? i < home && home <= j : i < home || home <= j)
+            continue;
+        prefetch->unused[i] = prefetch->unused[j];
+        i = j;
+    }
+    prefetch->unused[i] = 0;
+    prefetch->nunused--;
+    return 1;
+}
+
+/*
+ * evicted - Count a prefetched block that is evicted unused as useless
+ */
+static void evicted(prefetch_t *prefetch, int did_evict)
+{
+    cache_t *cache = prefetch->cache;
+
+    if (did_evict && unused_remove(prefetch, cache->victim >> cache->block_bits))
+        prefetch->useless++;
+}
+
+/*
+ * fill - Put a prefetched block in the cache; an eviction it causes is
+ *     the prefetcher's, not one of the demand misses the cache counts
+ */
+static void fill(prefetch_t *prefetch, uint64_t addr)
+{
+    int did_evict = cache_fill(prefetch->cache, addr, 0);
+
+    if (did_evict)
+    {
+        prefetch->cache->evictions--;
+        prefetch->evictions++;
+    }
+    evicted(prefetch, did_evict);
+}
+
+static int find_inflight(const prefetch_t *prefetch, uint64_t block)
+{
+    for (int i = 0; i < prefetch->ninflight; i++)
+        if (prefetch->mshr[i].block == block)
+            return i;
+    return -1;
+}
+
+/*
+ * issue - Start prefetching block unless it is cached, already on its
+ *     way, or every MSHR is busy
+ */
+static void issue(prefetch_t *prefetch, uint64_t block)
+{
+    inflight_t *mshr;
+
+    if (cache_probe(prefetch->cache, block << prefetch->cache->block_bits) ||
+        find_inflight(prefetch, block) >= 0 || prefetch->ninflight == PREFETCH_MSHRS)
+        return;
+    mshr = &prefetch->mshr[prefetch->ninflight++];
+    mshr->block = block;
+    mshr->ready = prefetch->now + prefetch->latency;
+    prefetch->issued++;
+}
+
+/*
+ * retire - Fill the prefetches that have arrived into the cache
+ */
+static void retire(prefetch_t *prefetch)
+{
+    cache_t *cache = prefetch->cache;
+    int i = 0;
+
+    while (i < prefetch->ninflight)
+    {
+        uint64_t block = prefetch->mshr[i].block;
+
+        if (prefetch->mshr[i].ready > prefetch->now)
+        {
+            i++;
+            continue;
+        }
+        prefetch->mshr[i] = prefetch->mshr[--prefetch->ninflight];
+        fill(prefetch, block << cache->block_bits);
+        unused_add(prefetch, block);
+    }
+}
+
+/*
+ * stride_train - Learn the stride of the region of addr and prefetch
+ *     along it once it repeats; strides under a block go a block at a
+ *     time, so small strides still run ahead
+ */
+static void stride_train(prefetch_t *prefetch, uint64_t addr)
+{
+    uint64_t region = addr >> STRIDE_REGION_BITS;
+    stride_entry_t *e = &prefetch->strides[region % STRIDE_ENTRIES];
+    int64_t bytes = (int64_t)1 << prefetch->cache->block_bits;
+    int64_t d, step;
+
+    if (!e->valid || e->region != region)
+    {
+        e->valid = 1;
+        e->region = region;
+        e->last = addr;
+        e->stride = 0;
+        e->confidence = 0;
+        return;
+    }
+    d = (int64_t)(addr - e->last);
+    if (d == 0)
+        return;
+    if (d == e->stride)
+        e->confidence += e->confidence < 3;
+    else
+    {
+        e->stride = d;
+        e->confidence = 0;
+    }
+    e->last = addr;
+    if (!e->confidence)
+        return;
+
+    step = d;
+    if (step > -bytes && step < bytes)
+        step = d > 0 ? bytes : -bytes;
+    for (int k = 1; k <= prefetch->degree; k++)
+        issue(prefetch, (addr + k * step) >> prefetch->cache->block_bits);
+}
+
+/*
+ * stream_refill - Fetch blocks into a stream buffer until it is full
+ */
+static void stream_refill(prefetch_t *prefetch, stream_t *s)
+{
+    while (s->count < prefetch->degree)
+    {
+        int pos = (s->head + s->count) % prefetch->degree;
+
+        s->block[pos] = s->next++;
+        s->ready[pos] = prefetch->now + prefetch->latency;
+        s->count++;
+        prefetch->issued++;
+    }
+}
+
+/*
+ * stream_access - A demand access behind stream buffers: a miss that
+ *     finds its block in a buffer takes it from there, dropping the
+ *     blocks ahead of it; any other miss starts a stream in the least
+ *     recently used buffer
+ */
+static cache_result_t stream_access(prefetch_t *prefetch, uint64_t addr)
+{
+    cache_t *cache = prefetch->cache;
+    uint64_t block = addr >> cache->block_bits;
+    stream_t *lru = &prefetch->streams[0];
+    cache_result_t result;
+
+    if (!cache_probe(cache, addr))
+    {
+        for (int b = 0; b < STREAM_BUFFERS && lru; b++)
+        {
+            stream_t *s = &prefetch->streams[b];
+
+            for (int j = 0; j < s->count; j++)
+            {
+                int pos = (s->head + j) % prefetch->degree;
+
+                if (s->block[pos] != block)
+                    continue;
+                prefetch->useless += j;
+                if (s->ready[pos] > prefetch->now)
+                    prefetch->late++;
+                else
+                {
+                    prefetch->useful++;
+                    fill(prefetch, addr);
+                }
+                s->head = (pos + 1) % prefetch->degree;
+                s->count -= j + 1;
+                stream_refill(prefetch, s);
+                s->used = prefetch->now;
+                lru = NULL;
+                break;
+            }
+            if (lru && s->used < lru->used)
+                lru = s;
+        }
+        if (lru)
+        {
+            prefetch->useless += lru->count;
+            lru->head = lru->count = 0;
+            lru->next = block + 1;
+            stream_refill(prefetch, lru);
+            lru->used = prefetch->now;
+        }
+    }
+    result = cache_access(cache, addr);
+    evicted(prefetch, result == CACHE_EVICT);
+    return result;
+}
+
+cache_result_t prefetch_access(prefetch_t *prefetch, uint64_t addr)
+{
+    uint64_t block = addr >> prefetch->cache->block_bits;
+    cache_result_t result;
+    int i, first_use;
+
+    prefetch->now++;
+    if (prefetch->kind == PREFETCH_STREAM)
+        return stream_access(prefetch, addr);
+
+    retire(prefetch);
+    // still on its way: the access misses anyway
+    if ((i = find_inflight(prefetch, block)) >= 0)
+    {
+        prefetch->late++;
+        prefetch->mshr[i] = prefetch->mshr[--prefetch->ninflight];
+    }
+    result = cache_access(prefetch->cache, addr);
+    evicted(prefetch, result == CACHE_EVICT);
+    first_use = result == CACHE_HIT && unused_remove(prefetch, block);
+    prefetch->useful += first_use;
+
+    if (prefetch->kind == PREFETCH_STRIDE)
+        stride_train(prefetch, addr);
+    else if (result != CACHE_HIT || first_use)
+        for (int k = 1; k <= prefetch->degree; k++)
+            issue(prefetch, block + k);
+    return result;
+}
+
+void prefetch_finish(prefetch_t *prefetch)
+{
+    prefetch->useless += prefetch->ninflight + prefetch->nunused;
+    prefetch->ninflight = 0;
+    memset(prefetch->unused, 0, prefetch->slots * sizeof(uint64_t));
+    prefetch->nunused = 0;
+    for (int b = 0; b < STREAM_BUFFERS; b++)
+    {
+        prefetch->useless += prefetch->streams[b].count;
+        prefetch->streams[b].count = 0;
+    }
+}
+
+void prefetch_counts(const prefetch_t *prefetch, long *issued, long *useful, long *late,
+                     long *useless, long *evictions)
+{
+    *issued = prefetch->issued;
+    *useful = prefetch->useful;
+    *late = prefetch->late;
+    *useless = prefetch->useless;
+    *evictions = prefetch->evictions;
+}
@@ -0,0 +1,66 @@
+/*
+ * prefetch.h - Hardware prefetcher models in front of a cache
+ *
+ * Three prefetchers are modelled:
+ *
+ * - next-line: a miss, or the first use of a prefetched block,
+ *   prefetches the next degree blocks;
+ * - stride: a table keyed by 4KB region (traces carry no PC) learns
+ *   the stride between accesses to each region and, once the same
+ *   stride is seen twice, prefetches degree blocks ahead along it;
+ * - stream: a few stream buffers (Jouppi) each hold the next degree
+ *   blocks after a miss, outside the cache; a miss that finds its block
+ *   in a buffer takes it from there and the buffer fetches one more.
+ *
+ * A prefetch takes latency demand accesses to arrive. At most
+ * PREFETCH_MSHRS next-line or stride prefetches are in flight; more are
+ * dropped. Every prefetch issued ends up useful (its block was used
+ * after it arrived), late (used while still in flight, so the access
+ * still misses) or useless (evicted or discarded unused, or never used
+ * by the end of the trace).
+ */
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+
+#include "cache.h"
+
+/* Prefetches in flight at once, for next-line and stride */
+#define PREFETCH_MSHRS 16
+
+typedef enum
+{
+    PREFETCH_NEXT_LINE,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM
+} prefetch_kind_t;
+
+typedef struct prefetch prefetch_t;
+
+/*
+ * Parse a prefetcher as given to csim -P: "next", "stride" or
+ * "stream", optionally followed by ",degree" and ",latency". Returns
+ * -1 if it is malformed.
+ */
+int prefetch_parse(const char *arg, prefetch_kind_t *kind, int *degree, int *latency);
+
+/* Put a prefetcher in front of cache, or return NULL */
+prefetch_t *prefetch_new(cache_t *cache, prefetch_kind_t kind, int degree, int latency);
+
+void prefetch_free(prefetch_t *prefetch);
+
+/* Make a demand access to the cache, and train and run the prefetcher */
+cache_result_t prefetch_access(prefetch_t *prefetch, uint64_t addr);
+
+/* Count the prefetches still unused as useless; call once at the end */
+void prefetch_finish(prefetch_t *prefetch);
+
+/*
+ * Prefetches issued, how they turned out, and the blocks their fills
+ * evicted (which the cache's own eviction count leaves out)
+ */
+void prefetch_counts(const prefetch_t *prefetch, long *issued, long *useful, long *late,
+                     long *useless, long *evictions);
+
+#endif /* PREFETCH_H */
@@ -0,0 +1,98 @@
+/*
+ * ptrans.c - Multithreaded transpose of large matrices
+ *
+ * The rows of B are split into nthreads contiguous bands, rounded to
+ * whole tiles, and thread i transposes the columns of A that make up
+ * band i with transpose_columns from trans.c. Splitting the output
+ * rather than the input keeps each thread's stores in its own pages:
+ * no two threads write the same cache line, and when the same split
+ * is used to first-touch B (first_touch_parallel), the pages a thread
+ * writes are local to its NUMA node. The reads of A are spread over
+ * all nodes either way. Thread i runs on the calling thread for i = 0.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ptrans.h"
+
+/* Bands start at multiples of this many rows of B (a tile) */
+#define BAND_ALIGN 8
+
+/* External function defined in trans.c */
+extern void transpose_columns(int M, int N, int A[N][M], int B[M][N], int c0, int c1);
+
+typedef struct
+{
+    pthread_t tid;
+    int M, N;
+    int *A, *B;
+    int c0, c1; /* band of rows of B */
+    int zero;   /* first_touch_parallel: only zero the band */
+} band_t;
+
+static void *run_band(void *arg)
+{
+    band_t *band = (band_t *)arg;
+    int M = band->M, N = band->N;
+
+    if (band->zero)
+        memset(band->B + (size_t)band->c0 * N, 0,
+               (size_t)(band->c1 - band->c0) * N * sizeof(int));
+    else
+        transpose_columns(M, N, (int (*)[M])band->A, (int (*)[N])band->B, band->c0, band->c1);
+    return NULL;
+}
+
+/*
+ * run_bands - Run one band per thread and wait for all of them
+ */
+static int run_bands(int M, int N, int *A, int *B, int nthreads, int zero)
+{
+    band_t *bands;
+    int i, started, ok = 1;
+
+    if (nthreads < 1)
+        nthreads = 1;
+    if ((bands = (band_t *)calloc(nthreads, sizeof(band_t))) == NULL)
+        return -1;
+    for (i = 0; i < nthreads; i++)
+    {
+        bands[i].M = M;
+        bands[i].N = N;
+        bands[i].A = A;
+        bands[i].B = B;
+        bands[i].c0 = (int)((long)M * i / nthreads / BAND_ALIGN * BAND_ALIGN);
+        bands[i].c1 = i + 1 == nthreads ? M
+                                        : (int)((long)M * (i + 1) / nthreads / BAND_ALIGN * BAND_ALIGN);
+        bands[i].zero = zero;
+    }
+
+    for (started = 1; started < nthreads; started++)
+    {
+        if (pthread_create(&bands[started].tid, NULL, run_band, &bands[started]))
+            break;
+    }
+    // bands whose thread did not start are run here, so B is complete
+    for (i = started; i < nthreads; i++)
+    {
+        run_band(&bands[i]);
+        ok = 0;
+    }
+    run_band(&bands[0]);
+    for (i = 1; i < started; i++)
+        pthread_join(bands[i].tid, NULL);
+    free(bands);
+    return ok ? 0 : -1;
+}
+
+int transpose_parallel(int M, int N, int A[N][M], int B[M][N], int nthreads)
+{
+    return run_bands(M, N, &A[0][0], &B[0][0], nthreads, 0);
+}
+
+int first_touch_parallel(int M, int N, int B[M][N], int nthreads)
+{
+    return run_bands(M, N, NULL, &B[0][0], nthreads, 1);
+}
@@ -0,0 +1,22 @@
+/*
+ * ptrans.h - Multithreaded transpose of large matrices
+ */
+#ifndef PTRANS_H
+#define PTRANS_H
+
+/*
+ * B = A^T with nthreads threads, each writing a band of rows of B
+ * (columns of A). Returns -1 if some threads could not be started;
+ * their bands are then done by the calling thread, so B is complete
+ * either way.
+ */
+int transpose_parallel(int M, int N, int A[N][M], int B[M][N], int nthreads);
+
+/*
+ * Zero B with the same split across threads as transpose_parallel,
+ * so that each page of B is first touched, and so placed, on the
+ * NUMA node of the thread that will write it. Returns as above.
+ */
+int first_touch_parallel(int M, int N, int B[M][N], int nthreads);
+
+#endif /* PTRANS_H */
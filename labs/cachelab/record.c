@@ -0,0 +1,66 @@
+/*
+ * record.c - The instrumentation hooks behind record.h
+ *
+ * These are the entry points gcc and clang call from code compiled
+ * with -fsanitize=thread. Loads and stores of any size are recorded
+ * (vector ones come as ranges); function entry and exit are ignored.
+ */
+#include <stddef.h>
+
+#include "record.h"
+
+static record_fn_t record_fn = NULL;
+
+void record_start(record_fn_t fn)
+{
+    record_fn = fn;
+}
+
+void record_stop(void)
+{
+    record_fn = NULL;
+}
+
+static inline void record(const void *addr, int size, int write)
+{
+    if (record_fn)
+        record_fn((uint64_t)(uintptr_t)addr, size, write);
+}
+
+/* Not declared in any header: the compiler emits the calls */
+#define HOOKS(n)                                                               \
+    void __tsan_read##n(void *addr);                                           \
+    void __tsan_write##n(void *addr);                                          \
+    void __tsan_unaligned_read##n(void *addr);                                 \
+    void __tsan_unaligned_write##n(void *addr);                                \
+    void __tsan_read##n(void *addr) { record(addr, n, 0); }                    \
+    void __tsan_write##n(void *addr) { record(addr, n, 1); }                   \
+    void __tsan_unaligned_read##n(void *addr) { record(addr, n, 0); }          \
+    void __tsan_unaligned_write##n(void *addr) { record(addr, n, 1); }
+
+HOOKS(1)
+HOOKS(2)
+HOOKS(4)
+HOOKS(8)
+HOOKS(16)
+
+void __tsan_read_range(void *addr, unsigned long size);
+void __tsan_write_range(void *addr, unsigned long size);
+
+void __tsan_read_range(void *addr, unsigned long size)
+{
+    record(addr, (int)size, 0);
+}
+
+void __tsan_write_range(void *addr, unsigned long size)
+{
+    record(addr, (int)size, 1);
+}
+
+void __tsan_init(void);
+void __tsan_func_entry(void *pc);
+void __tsan_func_exit(void);
+
+void __tsan_init(void) {}
+void __tsan_func_entry(void *pc) {}
+void __tsan_func_exit(void) {}
@@ -0,0 +1,26 @@
+/*
+ * record.h - In-process recording of the memory accesses of trans.c
+ *
+ * test-trans links a copy of trans.c compiled with -fsanitize=thread
+ * but without the ThreadSanitizer runtime: the compiler then calls a
+ * __tsan_read<n> or __tsan_write<n> hook before every load and store
+ * of memory (the matrices, but not locals kept in registers or on the
+ * stack frame), and record.c provides those hooks. Between
+ * record_start and record_stop, each access is passed to a callback,
+ * so the transpose functions can be run against a cache model without
+ * valgrind.
+ */
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+
+/* Called for every load (write = 0) or store (write = 1) of size bytes */
+typedef void (*record_fn_t)(uint64_t addr, int size, int write);
+
+/* Pass the accesses of instrumented code to fn until record_stop */
+void record_start(record_fn_t fn);
+
+void record_stop(void);
+
+#endif /* RECORD_H */
@@ -0,0 +1,342 @@
+/*
+ * sample.c - Sampled simulation with extrapolated counts
+ *
+ * Each stratum keeps, for hits, misses and evictions, the sum and the
+ * sum of squares of the per-access rate of its windows, which is all
+ * the stratified estimator needs. A window is only added once it is
+ * complete.
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample.h"
+
+/* Hits, misses and evictions */
+#define NCOUNTS 3
+
+typedef struct
+{
+    double weight; /* share of the trace it stands for */
+    long n;        /* windows measured */
+    double sum[NCOUNTS], sumsq[NCOUNTS];
+} stratum_t;
+
+typedef struct
+{
+    long index; /* interval */
+    int stratum;
+} point_t;
+
+struct sample
+{
+    long interval;
+    long window; /* measured accesses at the end of each chosen interval */
+    long warm;   /* accesses simulated before a window, or -1 for all */
+
+    point_t *points; /* chosen intervals by index; NULL when periodic */
+    long npoints;
+    long next_point; /* first point not behind the current access */
+
+    stratum_t *strata;
+    int nstrata;
+
+    long pos;          /* accesses so far */
+    long open;         /* interval of the window being measured, or -1 */
+    int open_stratum;
+    long open_len;     /* accesses measured in it */
+    long counts[NCOUNTS];
+
+    long windows;  /* complete windows */
+    long measured; /* accesses in them */
+};
+
+static const char *count_names[NCOUNTS] = {"hits", "misses", "evictions"};
+
+static sample_t *sample_new(long interval, long window, int nstrata)
+{
+    sample_t *sample = (sample_t *)calloc(1, sizeof(sample_t));
+
+    if (!sample)
+        return NULL;
+    sample->strata = (stratum_t *)calloc(nstrata, sizeof(stratum_t));
+    if (!sample->strata)
+    {
+        free(sample);
+        return NULL;
+    }
+    sample->nstrata = nstrata;
+    sample->interval = interval;
+    sample->window = window;
+    sample->warm = -1;
+    sample->open = -1;
+    return sample;
+}
+
+sample_t *sample_periodic(long interval, long window)
+{
+    sample_t *sample;
+
+    if (interval <= 0 || window <= 0 || window > interval)
+        return NULL;
+    sample = sample_new(interval, window, 1);
+    if (sample)
+        sample->strata[0].weight = 1;
+    return sample;
+}
+
+static int compare_index(const void *a, const void *b)
+{
+    const point_t *x = (const point_t *)a, *y = (const point_t *)b;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+sample_t *sample_load(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    long interval = 0, index, npoints = 0, max_points = 0;
+    int cluster, nstrata = 0, lineno = 0, ok = 1;
+    double weight, *weights = NULL;
+    point_t *points = NULL;
+    sample_t *sample = NULL;
+
+    if (!fp)
+    {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    while (ok && fgets(line, sizeof(line), fp))
+    {
+        char *p = line + strspn(line, " \t");
+        lineno++;
+        if (*p == '#' || *p == '\n' || *p == '\0')
+            continue;
+        if (sscanf(p, "interval %ld", &interval) == 1)
+            continue;
+        if (!interval || sscanf(p, "%ld %d %lf", &index, &cluster, &weight) != 3 || index < 0 ||
+            cluster < 0 || cluster > 1 << 16 || weight <= 0)
+        {
+            fprintf(stderr, "%s:%d: expected \"interval <n>\" and then \"index cluster weight\"\n",
+                    path, lineno);
+            ok = 0;
+            break;
+        }
+        if (npoints == max_points)
+        {
+            max_points = max_points ? 2 * max_points : 64;
+            point_t *more = (point_t *)realloc(points, max_points * sizeof(point_t));
+            if (!more)
+            {
+                ok = 0;
+                break;
+            }
+            points = more;
+        }
+        if (cluster >= nstrata)
+        {
+            double *more = (double *)realloc(weights, (cluster + 1) * sizeof(double));
+            if (!more)
+            {
+                ok = 0;
+                break;
+            }
+            weights = more;
+            while (nstrata <= cluster)
+                weights[nstrata++] = 0;
+        }
+        if (weights[cluster] && weights[cluster] != weight)
+        {
+            fprintf(stderr, "%s:%d: cluster %d has two weights\n", path, lineno, cluster);
+            ok = 0;
+        }
+        weights[cluster] = weight;
+        points[npoints].index = index;
+        points[npoints].stratum = cluster;
+        npoints++;
+    }
+    fclose(fp);
+
+    if (ok && !npoints)
+    {
+        fprintf(stderr, "%s: no intervals to measure\n", path);
+        ok = 0;
+    }
+    if (ok)
+    {
+        qsort(points, npoints, sizeof(point_t), compare_index);
+        for (long i = 1; i < npoints; i++)
+        {
+            if (points[i].index == points[i - 1].index)
+            {
+                fprintf(stderr, "%s: interval %ld is listed twice\n", path, points[i].index);
+                ok = 0;
+                break;
+            }
+        }
+    }
+    if (ok && !(sample = sample_new(interval, interval, nstrata)))
+        fprintf(stderr, "out of memory reading %s\n", path);
+    if (sample)
+    {
+        for (int c = 0; c < nstrata; c++)
+            sample->strata[c].weight = weights[c];
+        sample->points = points;
+        sample->npoints = npoints;
+        points = NULL;
+    }
+    free(points);
+    free(weights);
+    return sample;
+}
+
+void sample_free(sample_t *sample)
+{
+    if (!sample)
+        return;
+    free(sample->points);
+    free(sample->strata);
+    free(sample);
+}
+
+void sample_set_warm(sample_t *sample, long warm)
+{
+    sample->warm = warm;
+}
+
+/*
+ * close_window - Add the open window to its stratum if it is complete
+ */
+static void close_window(sample_t *sample)
+{
+    stratum_t *stratum;
+
+    if (sample->open < 0)
+        return;
+    sample->open = -1;
+    stratum = &sample->strata[sample->open_stratum];
+    if (sample->open_len < sample->window)
+        return;
+    for (int k = 0; k < NCOUNTS; k++)
+    {
+        double rate = (double)sample->counts[k] / sample->window;
+        stratum->sum[k] += rate;
+        stratum->sumsq[k] += rate * rate;
+    }
+    stratum->n++;
+    sample->windows++;
+    sample->measured += sample->window;
+}
+
+sample_role_t sample_next(sample_t *sample)
+{
+    long i = sample->pos++;
+    long index = i / sample->interval;
+    long start = sample->interval - sample->window; // offset of a window in its interval
+    long next;                                      // first access of the next window
+    int stratum = 0, chosen;
+
+    if (sample->points)
+    {
+        while (sample->next_point < sample->npoints &&
+               sample->points[sample->next_point].index < index)
+            sample->next_point++;
+        chosen = sample->next_point < sample->npoints &&
+                 sample->points[sample->next_point].index == index;
+        if (chosen)
+            stratum = sample->points[sample->next_point].stratum;
+    }
+    else
+        chosen = 1;
+
+    if (chosen && i % sample->interval >= start)
+    {
+        if (sample->open != index)
+        {
+            close_window(sample);
+            sample->open = index;
+            sample->open_stratum = stratum;
+            sample->open_len = 0;
+            memset(sample->counts, 0, sizeof(sample->counts));
+        }
+        sample->open_len++;
+        return SAMPLE_MEASURE;
+    }
+    close_window(sample);
+
+    if (sample->warm < 0)
+        return SAMPLE_WARM;
+    if (!sample->points)
+        next = index * sample->interval + start;
+    else if (sample->next_point < sample->npoints)
+        next = sample->points[sample->next_point].index * sample->interval;
+    else
+        return SAMPLE_SKIP;
+    return next - i <= sample->warm ? SAMPLE_WARM : SAMPLE_SKIP;
+}
+
+void sample_count(sample_t *sample, cache_result_t result, int modify)
+{
+    sample->counts[result == CACHE_HIT ? 0 : 1]++;
+    sample->counts[2] += result == CACHE_EVICT;
+    sample->counts[0] += modify;
+}
+
+int sample_finish(sample_t *sample)
+{
+    close_window(sample);
+    return sample->windows ? 0 : -1;
+}
+
+void sample_estimate(const sample_t *sample, long estimate[3], long error[3])
+{
+    double weights = 0;
+
+    // strata none of whose windows were measured drop out
+    for (int c = 0; c < sample->nstrata; c++)
+        if (sample->strata[c].n)
+            weights += sample->strata[c].weight;
+
+    for (int k = 0; k < NCOUNTS; k++)
+    {
+        double rate = 0, var = 0;
+
+        for (int c = 0; c < sample->nstrata; c++)
+        {
+            const stratum_t *s = &sample->strata[c];
+            double w = s->weight / weights, mean;
+
+            if (!s->n)
+                continue;
+            mean = s->sum[k] / s->n;
+            rate += w * mean;
+            if (s->n > 1)
+                var += w * w * (s->sumsq[k] - s->n * mean * mean) / (s->n - 1) / s->n;
+        }
+        estimate[k] = lround(rate * sample->pos);
+        error[k] = lround(SAMPLE_Z * sqrt(var > 0 ? var : 0) * sample->pos);
+    }
+}
+
+void sample_print(const sample_t *sample, FILE *out)
+{
+    long estimate[NCOUNTS], error[NCOUNTS];
+    int single = 0, strata = 0;
+
+    for (int c = 0; c < sample->nstrata; c++)
+    {
+        strata += sample->strata[c].n > 0;
+        single += sample->strata[c].n == 1;
+    }
+    fprintf(out, "sampled %ld windows of %ld accesses in %d strata: %ld of %ld accesses (%.2f%%)\n",
+            sample->windows, sample->window, strata, sample->measured, sample->pos,
+            100.0 * sample->measured / sample->pos);
+    if (single)
+        fprintf(out, "%d strata have a single window and add no error\n", single);
+
+    sample_estimate(sample, estimate, error);
+    for (int k = 0; k < NCOUNTS; k++)
+        fprintf(out, "%s%s:%ld+-%ld", k ? " " : "", count_names[k], estimate[k], error[k]);
+    fprintf(out, " (95%% confidence)\n");
+}
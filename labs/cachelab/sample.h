@@ -0,0 +1,74 @@
+/*
+ * sample.h - Sampled simulation with extrapolated counts
+ *
+ * The trace is cut into intervals of a fixed number of accesses, and
+ * only some windows of it are measured:
+ *
+ * - periodic: the last window accesses of every interval;
+ * - phases: the whole of the intervals listed in a points file written
+ *   by the phases tool, each tagged with its cluster and the share of
+ *   the trace the cluster stands for.
+ *
+ * Between windows the cache is warmed functionally: it sees every
+ * access, but nothing is counted. A warming limit makes the simulation
+ * skip all but the last accesses before each window instead, which is
+ * faster but leaves the cache colder.
+ *
+ * The hit, miss and eviction counts per access of the windows are
+ * combined as a stratified sample (the clusters are the strata; a
+ * periodic sample has one) and scaled to the whole trace, with 95%
+ * confidence intervals from the variance within each stratum.
+ */
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdio.h>
+
+#include "cache.h"
+
+/* Normal quantile of the two-sided 95% confidence intervals */
+#define SAMPLE_Z 1.96
+
+/* What to do with an access */
+typedef enum
+{
+    SAMPLE_SKIP,   /* read past it */
+    SAMPLE_WARM,   /* simulate it without counting */
+    SAMPLE_MEASURE /* simulate and count it */
+} sample_role_t;
+
+typedef struct sample sample_t;
+
+/* Measure the last window accesses of every interval, or return NULL */
+sample_t *sample_periodic(long interval, long window);
+
+/*
+ * Measure the intervals listed in a points file; returns NULL and
+ * prints the reason to stderr if it cannot be read or is malformed.
+ */
+sample_t *sample_load(const char *path);
+
+void sample_free(sample_t *sample);
+
+/* Simulate only the warm accesses before each window (default: all) */
+void sample_set_warm(sample_t *sample, long warm);
+
+/* Role of the next access of the trace; call once per access, in order */
+sample_role_t sample_next(sample_t *sample);
+
+/* Count the result of a measured access; modify adds the hit of its store */
+void sample_count(sample_t *sample, cache_result_t result, int modify);
+
+/*
+ * Close the sample once the trace is done: a window cut short by the
+ * end of the trace is dropped. Returns -1 if no window was measured.
+ */
+int sample_finish(sample_t *sample);
+
+/* Extrapolated totals for the whole trace, and the half-widths of their intervals */
+void sample_estimate(const sample_t *sample, long estimate[3], long error[3]);
+
+/* Print what was measured and the extrapolated counts with their errors */
+void sample_print(const sample_t *sample, FILE *out);
+
+#endif /* SAMPLE_H */
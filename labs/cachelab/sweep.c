@@ -0,0 +1,200 @@
+/*
+ * sweep.c - Single-pass simulation of many LRU cache geometries
+ *
+ * LRU has the inclusion property: a set with E lines holds exactly the
+ * E most recently used blocks that map to it. So for each set count we
+ * keep one recency stack per set, truncated to max_E entries, and
+ * record how deep each access finds its block. An access hits in every
+ * cache with more lines per set than that depth, so the depth
+ * histogram gives the misses for all E at once.
+ *
+ * Evictions follow from the misses: each set of an E-way cache fills
+ * once for each of its first E distinct blocks, and every other miss
+ * evicts. A table of the blocks seen so far tracks how many distinct
+ * blocks map to each set.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "sweep.h"
+
+struct sweep
+{
+    int max_set_bits;
+    int max_lines;
+    int block_bits;
+    long accesses;
+
+    /* for each s: 2^s stacks of max_lines blocks, most recent first */
+    uint64_t **stacks;
+    int **depth;     /* number of blocks in each stack */
+    int **distinct;  /* distinct blocks seen in each set */
+    long *hist;      /* hist[s * max_lines + d]: accesses found at depth d */
+
+    /* open-addressing set of block numbers + 1 (0 marks a free slot) */
+    uint64_t *seen;
+    size_t seen_slots;
+    size_t seen_count;
+};
+
+static size_t hash_block(uint64_t block)
+{
+    return (size_t)(block * 0x9E3779B97F4A7C15ULL >> 17);
+}
+
+/*
+ * insert_seen - Add block to the seen table; returns 1 if it is new
+ */
+static int insert_seen(sweep_t *sweep, uint64_t block)
+{
+    size_t mask = sweep->seen_slots - 1;
+    size_t i = hash_block(block) & mask;
+
+    while (sweep->seen[i])
+    {
+        if (sweep->seen[i] == block + 1)
+            return 0;
+        i = (i + 1) & mask;
+    }
+    sweep->seen[i] = block + 1;
+    sweep->seen_count++;
+
+    if (2 * sweep->seen_count > sweep->seen_slots)
+    {
+        // grow: rehash into a table twice the size
+        uint64_t *old = sweep->seen;
+        size_t old_slots = sweep->seen_slots;
+
+        sweep->seen_slots *= 2;
+        sweep->seen = (uint64_t *)calloc(sweep->seen_slots, sizeof(uint64_t));
+        if (!sweep->seen)
+            abort();
+        mask = sweep->seen_slots - 1;
+        for (size_t j = 0; j < old_slots; j++)
+        {
+            if (!old[j])
+                continue;
+            i = hash_block(old[j] - 1) & mask;
+            while (sweep->seen[i])
+                i = (i + 1) & mask;
+            sweep->seen[i] = old[j];
+        }
+        free(old);
+    }
+    return 1;
+}
+
+sweep_t *sweep_new(int max_set_bits, int max_lines, int block_bits)
+{
+    sweep_t *sweep;
+    int s;
+
+    if (max_set_bits < 0 || max_set_bits >= 32 || max_lines <= 0 || block_bits < 0 ||
+        max_set_bits + block_bits >= 64)
+        return NULL;
+    if ((sweep = (sweep_t *)calloc(1, sizeof(sweep_t))) == NULL)
+        return NULL;
+    sweep->max_set_bits = max_set_bits;
+    sweep->max_lines = max_lines;
+    sweep->block_bits = block_bits;
+    sweep->stacks = (uint64_t **)calloc(max_set_bits + 1, sizeof(uint64_t *));
+    sweep->depth = (int **)calloc(max_set_bits + 1, sizeof(int *));
+    sweep->distinct = (int **)calloc(max_set_bits + 1, sizeof(int *));
+    sweep->hist = (long *)calloc((size_t)(max_set_bits + 1) * max_lines, sizeof(long));
+    sweep->seen_slots = 1024;
+    sweep->seen = (uint64_t *)calloc(sweep->seen_slots, sizeof(uint64_t));
+    if (!sweep->stacks || !sweep->depth || !sweep->distinct || !sweep->hist || !sweep->seen)
+    {
+        sweep_free(sweep);
+        return NULL;
+    }
+    for (s = 0; s <= max_set_bits; s++)
+    {
+        size_t sets = (size_t)1 << s;
+
+        sweep->stacks[s] = (uint64_t *)malloc(sets * max_lines * sizeof(uint64_t));
+        sweep->depth[s] = (int *)calloc(sets, sizeof(int));
+        sweep->distinct[s] = (int *)calloc(sets, sizeof(int));
+        if (!sweep->stacks[s] || !sweep->depth[s] || !sweep->distinct[s])
+        {
+            sweep_free(sweep);
+            return NULL;
+        }
+    }
+    return sweep;
+}
+
+void sweep_free(sweep_t *sweep)
+{
+    if (!sweep)
+        return;
+    for (int s = 0; s <= sweep->max_set_bits; s++)
+    {
+        if (sweep->stacks)
+            free(sweep->stacks[s]);
+        if (sweep->depth)
+            free(sweep->depth[s]);
+        if (sweep->distinct)
+            free(sweep->distinct[s]);
+    }
+    free(sweep->stacks);
+    free(sweep->depth);
+    free(sweep->distinct);
+    free(sweep->hist);
+    free(sweep->seen);
+    free(sweep);
+}
+
+void sweep_access(sweep_t *sweep, uint64_t addr)
+{
+    uint64_t block = addr >> sweep->block_bits;
+    int lines = sweep->max_lines;
+    int is_new = insert_seen(sweep, block);
+
+    sweep->accesses++;
+    for (int s = 0; s <= sweep->max_set_bits; s++)
+    {
+        uint64_t set_id = block & (((uint64_t)1 << s) - 1);
+        uint64_t *stack = sweep->stacks[s] + set_id * lines;
+        int *depth = &sweep->depth[s][set_id];
+        int d = 0;
+
+        if (is_new)
+        {
+            sweep->distinct[s][set_id]++;
+            d = *depth;
+        }
+        else
+        {
+            while (d < *depth && stack[d] != block)
+                d++;
+        }
+
+        if (d < *depth)
+            sweep->hist[s * lines + d]++;
+        else if (*depth < lines)
+            (*depth)++;
+        else
+            d = lines - 1; // missed everywhere: drop the bottom of the stack
+
+        // move the block to the top
+        memmove(stack + 1, stack, d * sizeof(uint64_t));
+        stack[0] = block;
+    }
+}
+
+void sweep_result(const sweep_t *sweep, int set_bits, int lines, long *hits, long *misses,
+                  long *evictions)
+{
+    const long *hist = sweep->hist + (size_t)set_bits * sweep->max_lines;
+    size_t sets = (size_t)1 << set_bits;
+    long h = 0, fills = 0;
+
+    for (int d = 0; d < lines; d++)
+        h += hist[d];
+    for (size_t i = 0; i < sets; i++)
+        fills += sweep->distinct[set_bits][i] < lines ? sweep->distinct[set_bits][i] : lines;
+    *hits = h;
+    *misses = sweep->accesses - h;
+    *evictions = *misses - fills;
+}
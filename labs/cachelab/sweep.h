@@ -0,0 +1,27 @@
+/*
+ * sweep.h - Single-pass simulation of many LRU cache geometries
+ *
+ * For a fixed block size, one pass over a trace gives the hits,
+ * misses and evictions of every cache with S = 2^s sets, s <= max_s,
+ * and E <= max_E lines per set (Mattson et al.'s stack algorithm).
+ */
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+
+typedef struct sweep sweep_t;
+
+/* Create a sweep over s in [0, max_s] and E in [1, max_E], or NULL */
+sweep_t *sweep_new(int max_set_bits, int max_lines, int block_bits);
+
+void sweep_free(sweep_t *sweep);
+
+/* Feed one access to every cache of the sweep */
+void sweep_access(sweep_t *sweep, uint64_t addr);
+
+/* Counts for the cache with 2^set_bits sets of lines lines each */
+void sweep_result(const sweep_t *sweep, int set_bits, int lines, long *hits, long *misses,
+                  long *evictions);
+
+#endif /* SWEEP_H */
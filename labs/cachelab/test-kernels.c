@@ -0,0 +1,307 @@
+/*
+ * test-kernels.c - Evaluates the kernels registered in kernels.c
+ *
+ * Each kernel is run twice. The copy of kernels.c built with the hooks
+ * of record.h runs on small matrices with its accesses fed to a cache
+ * model, as test-trans -p does for the transposes; the copy built with
+ * -O2 runs on larger matrices and is timed, as in bench-trans. Both
+ * results are checked against a reference for the kernel's kind, and
+ * each is also given relative to the first kernel of its kind, so the
+ * tiling choices can be compared on the model and on the machine.
+ *
+ * The default model is a 32KB 8-way L1 data cache with 64-byte lines.
+ */
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "cache.h"
+#include "record.h"
+
+#define TIME_MIN_SECONDS 0.05
+#define TIME_TRIALS 3
+
+/* External functions defined in the two builds of kernels.c */
+extern void registerKernels();
+extern void registerKernelsRecorded();
+
+/* External variables defined in cachelab.c */
+extern kernel_func_t kernel_list[MAX_KERNEL_FUNCS];
+extern int kernel_counter;
+
+static const char *kind_names[NUM_KERNEL_KINDS] = {"gemm", "stencil", "inplace"};
+
+/* The operands, big enough for either size, and the expected result */
+static double *A, *B, *C, *R;
+
+/* Bytes of each operand at the size being simulated */
+static size_t model_bytes;
+
+/* The cache the recorded accesses go to */
+static cache_t *model;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int in_operand(uint64_t addr, const double *m)
+{
+    return addr >= (uint64_t)(uintptr_t)m && addr < (uint64_t)(uintptr_t)m + model_bytes;
+}
+
+/*
+ * model_access - Simulate a recorded access if it is to an operand;
+ *     the locals of the -O0 build live on the stack and are dropped
+ */
+static void model_access(uint64_t addr, int size, int write)
+{
+    if (in_operand(addr, A) || in_operand(addr, B) || in_operand(addr, C))
+        cache_access(model, addr);
+}
+
+/*
+ * fill - Give the operands of an n x n kernel the same values each time
+ */
+static void fill(int n)
+{
+    size_t k, elems = (size_t)n * n;
+
+    srand(1);
+    for (k = 0; k < elems; k++) {
+        A[k] = (double)rand() / RAND_MAX;
+        B[k] = (double)rand() / RAND_MAX;
+        C[k] = (double)rand() / RAND_MAX;
+    }
+}
+
+/*
+ * reference - Compute into R what a kernel of the given kind leaves in
+ *     its output operand
+ */
+static void reference(kernel_kind_t kind, int n)
+{
+    double (*a)[n] = (double (*)[n])A, (*b)[n] = (double (*)[n])B;
+    double (*c)[n] = (double (*)[n])C, (*r)[n] = (double (*)[n])R;
+    int i, j, k;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            switch (kind) {
+            case KERNEL_GEMM:
+                r[i][j] = c[i][j];
+                for (k = 0; k < n; k++)
+                    r[i][j] += a[i][k] * b[k][j];
+                break;
+            case KERNEL_STENCIL:
+                if (i == 0 || j == 0 || i == n - 1 || j == n - 1)
+                    r[i][j] = a[i][j];
+                else
+                    r[i][j] = 0.2 * (a[i][j] + a[i - 1][j] + a[i + 1][j] +
+                                     a[i][j - 1] + a[i][j + 1]);
+                break;
+            default:
+                r[i][j] = a[j][i];
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * is_correct - Check the output operand of a kernel of the given kind
+ *     against R; a GEMM may sum in another order, so it gets a
+ *     tolerance
+ */
+static int is_correct(kernel_kind_t kind, int n)
+{
+    const double *out = kind == KERNEL_GEMM ? C : kind == KERNEL_STENCIL ? B : A;
+    double tolerance = kind == KERNEL_GEMM ? 1e-12 * n : 0;
+    size_t k, elems = (size_t)n * n;
+
+    for (k = 0; k < elems; k++)
+        if (fabs(out[k] - R[k]) > tolerance * fabs(R[k]))
+            return 0;
+    return 1;
+}
+
+/*
+ * run_recorded - Run the recorded build of kernel i on n x n operands
+ *     with its accesses fed to a new (s, E, b) cache; returns the
+ *     cache, or NULL if the kernel's result is wrong
+ */
+static cache_t *run_recorded(int i, int n, unsigned int s, unsigned int E, unsigned int b)
+{
+    kernel_kind_t kind = kernel_list[i].kind;
+
+    fill(n);
+    reference(kind, n);
+    model_bytes = (size_t)n * n * sizeof(double);
+    model = cache_new(s, E, b);
+    if (!model) {
+        fprintf(stderr, "Error: Cannot allocate the cache model\n");
+        exit(1);
+    }
+    record_start(model_access);
+    (*kernel_list[i].recorded_ptr)(n, (double (*)[n])A, (double (*)[n])B, (double (*)[n])C);
+    record_stop();
+    if (!is_correct(kind, n)) {
+        cache_free(model);
+        return NULL;
+    }
+    return model;
+}
+
+/*
+ * time_kernel - Check the optimized build of kernel i on n x n
+ *     operands, and return its best seconds per call over the trials,
+ *     or -1 if its result is wrong
+ */
+static double time_kernel(int i, int n)
+{
+    kernel_fn_t fn = kernel_list[i].func_ptr;
+    double best = 1e30;
+    int trial;
+
+    fill(n);
+    reference(kernel_list[i].kind, n);
+    (*fn)(n, (double (*)[n])A, (double (*)[n])B, (double (*)[n])C);
+    if (!is_correct(kernel_list[i].kind, n))
+        return -1;
+
+    /* The kernels may keep updating their output; only time matters */
+    for (trial = 0; trial < TIME_TRIALS; trial++) {
+        long calls = 0;
+        double start = now(), elapsed;
+
+        do {
+            (*fn)(n, (double (*)[n])A, (double (*)[n])B, (double (*)[n])C);
+            calls++;
+            elapsed = now() - start;
+        } while (elapsed < TIME_MIN_SECONDS);
+        if (elapsed / calls < best)
+            best = elapsed / calls;
+    }
+    return best;
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-s <s>] [-E <E>] [-b <b>] [-n <size>] [-T <size>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -s <s>      Set index bits of the model (default 6)\n");
+    printf("  -E <E>      Associativity of the model (default 8)\n");
+    printf("  -b <b>      Block bits of the model (default 6)\n");
+    printf("  -n <size>   Matrix size simulated on the model (default 128)\n");
+    printf("  -T <size>   Matrix size timed, 0 to skip timing (default 512)\n");
+    printf("Example: %s -s 5 -E 1 -b 5 -n 32 -T 0\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    int c, i;
+    int s = 6, E = 8, b = 6, n = 128, timed_n = 512;
+    size_t elems;
+    long misses, first_misses = 0;
+    double seconds, first_seconds = 0;
+    cache_t *cache;
+
+    while ((c = getopt(argc, argv, "s:E:b:n:T:h")) != -1) {
+        switch (c) {
+        case 's':
+            s = atoi(optarg);
+            break;
+        case 'E':
+            E = atoi(optarg);
+            break;
+        case 'b':
+            b = atoi(optarg);
+            break;
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 'T':
+            timed_n = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (s < 0 || E <= 0 || b < 0 || n <= 0 || timed_n < 0) {
+        printf("Error: Invalid argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    elems = (size_t)(n > timed_n ? n : timed_n) * (n > timed_n ? n : timed_n);
+    A = (double *)malloc(elems * sizeof(double));
+    B = (double *)malloc(elems * sizeof(double));
+    C = (double *)malloc(elems * sizeof(double));
+    R = (double *)malloc(elems * sizeof(double));
+    if (!A || !B || !C || !R) {
+        printf("Error: Cannot allocate the matrices\n");
+        exit(1);
+    }
+
+    registerKernels();
+    registerKernelsRecorded();
+
+    printf("Misses of %dx%d doubles on (s=%d, E=%d, b=%d)", n, n, s, E, b);
+    if (timed_n > 0)
+        printf(", time of %dx%d doubles", timed_n, timed_n);
+    printf("; ratios are to the first kernel of each kind\n");
+    printf("%-8s %-36s %10s %10s %10s %6s", "kind", "kernel", "hits", "misses", "evictions",
+           "ratio");
+    if (timed_n > 0)
+        printf(" %12s %6s", "ms/call", "ratio");
+    printf("\n");
+
+    for (i = 0; i < kernel_counter; i++) {
+        if (i == 0 || kernel_list[i].kind != kernel_list[i - 1].kind) {
+            first_misses = 0;
+            first_seconds = 0;
+        }
+        printf("%-8s %-36s", kind_names[kernel_list[i].kind], kernel_list[i].description);
+
+        cache = run_recorded(i, n, s, E, b);
+        if (!cache) {
+            printf(" incorrect result\n");
+            continue;
+        }
+        misses = cache->misses;
+        if (!first_misses)
+            first_misses = misses;
+        printf(" %10ld %10ld %10ld %6.2f", cache->hits, misses, cache->evictions,
+               first_misses ? (double)misses / first_misses : 0.0);
+        cache_free(cache);
+
+        if (timed_n > 0) {
+            seconds = time_kernel(i, timed_n);
+            if (seconds < 0) {
+                printf(" incorrect result at -O2\n");
+                continue;
+            }
+            if (!first_seconds)
+                first_seconds = seconds;
+            printf(" %12.3f %6.2f", seconds * 1e3, seconds / first_seconds);
+        }
+        printf("\n");
+    }
+
+    free(A);
+    free(B);
+    free(C);
+    free(R);
+    return 0;
+}
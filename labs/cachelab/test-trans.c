@@ -3,6 +3,7 @@
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
  */
+#define _POSIX_C_SOURCE 200809L /* for popen */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -12,6 +13,8 @@
 #include <getopt.h>
 #include <sys/types.h>
 #include "cachelab.h"
+#include "cache.h"
+#include "record.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
 
@@ -41,6 +44,16 @@ struct results {
 };
 static struct results results = {-1, 0, INT_MAX};
 
+/* Matrices and markers for the in-process evaluation; B is 256KB after
+   A, as in tracegen */
+volatile char MARKER_START, MARKER_END;
+static int A[MAXN][MAXN];
+static int B[MAXN][MAXN];
+static int C[MAXN][MAXN];
+
+/* The cache the recorded accesses go to */
+static cache_t *model;
+
 /* 
  * eval_perf - Evaluate the performance of the registered transpose functions
  */
@@ -48,15 +61,21 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
 {
     int i,flag;
     unsigned int len, hits, misses, evictions;
+    int have_markers;
     unsigned long long int marker_start, marker_end, addr;
     char buf[1000], cmd[255];
     char filename[128];
 
     registerFunctions(); 
 
-    /* Open the complete trace file */
+    /* The full trace is piped from valgrind, and the part for the
+       transpose function goes to the simulator as it is read */
     FILE* full_trace_fp;  
     FILE* part_trace_fp; 
+    FILE* csim_fp;
+
+    /* Don't die if the simulator exits early; its status tells */
+    signal(SIGPIPE, SIG_IGN);
 
     /* Evaluate the performance of each registered transpose function */
 
@@ -66,39 +85,33 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
 
 
         printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
-        /* Use valgrind to generate the trace */
-
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
-        flag=WEXITSTATUS(system(cmd));
-        if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
-            continue;
-        }
-
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
-
+        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
 
-        func_list[i].correct=1;
+        /* tracegen rewrites .marker before it first touches a marker */
+        unlink(".marker");
+        remove(".csim_results");
+        have_markers = 0;
 
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i ) {
-            results.correct = 1;
-        }
+        /* Run the reference simulator on the region as it streams in */
+        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t /dev/stdin > /dev/null", 
+                s, E, b);
+        csim_fp = popen(cmd, "w");
+        assert(csim_fp);
 
-        full_trace_fp = fopen("trace.tmp", "r");
+        /* Use valgrind to generate the trace */
+        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d", M, N,i);
+        full_trace_fp = popen(cmd, "r");
         assert(full_trace_fp);
 
-
-        /* Filtered trace for each transpose function goes in a separate file */
+        /* The filtered trace for each transpose function also goes in
+           a separate file */
         sprintf(filename, "trace.f%d", i);
         part_trace_fp = fopen(filename, "w");
         assert(part_trace_fp);
     
-        /* Locate trace corresponding to the trans function */
+        /* Locate trace corresponding to the trans function. Read the
+           whole trace, so that valgrind runs to the end and its exit
+           status tells whether the function was correct. */
         flag = 0;
         while (fgets(buf, 1000, full_trace_fp) != NULL) {
 
@@ -106,6 +119,19 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
             if (buf[0]==' ' && buf[2]==' ' &&
                 (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
                 sscanf(buf+3, "%llx,%u", &addr, &len);
+
+                /* The markers are set with one-byte stores; by the
+                   first of those, .marker is complete */
+                if (!have_markers && buf[1]=='S' && len==1) {
+                    FILE* marker_fp = fopen(".marker", "r");
+                    if (marker_fp) {
+                        have_markers = fscanf(marker_fp, "%llx %llx",
+                                              &marker_start, &marker_end) == 2;
+                        fclose(marker_fp);
+                    }
+                }
+                if (!have_markers || flag == 2)
+                    continue;
         
                 /* If start marker found, set flag */
                 if (addr == marker_start)
@@ -122,25 +148,29 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
                    include the student stack references. */
                 if (flag && addr < 0xffffffff) {
                     fputs(buf, part_trace_fp);
+                    fputs(buf, csim_fp);
                 }
 
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
-                    flag = 0;
-                    fclose(part_trace_fp);
-                    break;
-                }
+                /* if end marker found, skip the rest of the trace */
+                if (addr == marker_end)
+                    flag = 2;
             }
         }
-        fclose(full_trace_fp);
+        fclose(part_trace_fp);
+        flag = WEXITSTATUS(pclose(full_trace_fp));
+        pclose(csim_fp);
+        if (0!=flag) {
+            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
+            continue;
+        }
+
+        func_list[i].correct=1;
+
+        /* Save the correctness of the transpose submission */
+        if (results.funcid == i ) {
+            results.correct = 1;
+        }
 
-        /* Run the reference simulator */
-        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
-    
         /* Collect results from the reference simulator */
         FILE* in_fp = fopen(".csim_results","r");
         assert(in_fp);
@@ -160,13 +190,145 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
   
 }
 
+/*
+ * model_access - Simulate a recorded access if it is to a matrix, as
+ *     the filter on the valgrind trace drops the stack
+ */
+static void model_access(uint64_t addr, int size, int write)
+{
+    if ((addr >= (uint64_t)(uintptr_t)A && addr < (uint64_t)(uintptr_t)A + sizeof(A)) ||
+        (addr >= (uint64_t)(uintptr_t)B && addr < (uint64_t)(uintptr_t)B + sizeof(B)))
+        cache_access(model, addr);
+}
+
+/*
+ * run_recorded - Run function fn on an m x n matrix with its accesses
+ *     fed to a new (s, E, b) cache; returns the cache, or NULL if the
+ *     function did not transpose correctly
+ */
+static cache_t *run_recorded(int fn, int m, int n,
+                             unsigned int s, unsigned int E, unsigned int b)
+{
+    int r, c, ok;
+
+    initMatrix(m, n, (int (*)[m])A, (int (*)[n])B);
+    model = cache_new(s, E, b);
+    assert(model);
+
+    /* The markers bound the region in the valgrind trace, so they
+       are simulated too */
+    cache_access(model, (uint64_t)(uintptr_t)&MARKER_START);
+    record_start(model_access);
+    (*func_list[fn].func_ptr)(m, n, (int (*)[m])A, (int (*)[n])B);
+    record_stop();
+    cache_access(model, (uint64_t)(uintptr_t)&MARKER_END);
+
+    correctTrans(m, n, (int (*)[m])A, (int (*)[n])C);
+    ok = 1;
+    for (r = 0; r < m && ok; r++)
+        for (c = 0; c < n && ok; c++)
+            ok = ((int (*)[n])B)[r][c] == ((int (*)[n])C)[r][c];
+    if (!ok) {
+        cache_free(model);
+        return NULL;
+    }
+    return model;
+}
+
+/*
+ * eval_perf_inprocess - Evaluate the registered transpose functions by
+ *     running them here with their accesses recorded (see record.h)
+ *     and fed to a cache model, instead of tracing them with valgrind
+ */
+void eval_perf_inprocess(unsigned int s, unsigned int E, unsigned int b)
+{
+    int i;
+    cache_t *cache;
+
+    registerFunctions(); 
+
+    for (i=0; i<func_counter; i++) {
+        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
+            results.funcid = i; /* remember which function is the submission */
+
+        printf("\nFunction %d (%d total)\nStep 1: Validating and recording memory accesses\n",i,func_counter);
+        cache = run_recorded(i, M, N, s, E, b);
+        if (!cache) {
+            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",i,M,N,i);
+            continue;
+        }
+
+        func_list[i].correct=1;
+        if (results.funcid == i )
+            results.correct = 1;
+
+        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
+        func_list[i].num_hits = cache->hits;
+        func_list[i].num_misses = cache->misses;
+        func_list[i].num_evictions = cache->evictions;
+        printf("func %u (%s): hits:%ld, misses:%ld, evictions:%ld\n",
+               i, func_list[i].description, cache->hits, cache->misses, cache->evictions);
+        if (results.funcid == i)
+            results.misses = cache->misses;
+        cache_free(cache);
+    }
+}
+
+/*
+ * sweep_shapes - Print the misses of every registered function on a
+ *     range of matrix shapes, square and not, and the ratio of the
+ *     misses to the compulsory ones (every block of A and B once);
+ *     "-" marks an incorrect result
+ */
+void sweep_shapes(unsigned int s, unsigned int E, unsigned int b)
+{
+    static const int sizes[] = {1, 7, 16, 31, 32, 33, 48, 61, 64, 67, 96, 100, 128, 200, 256};
+    const int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    int i, m, n;
+    cache_t *cache;
+
+    registerFunctions();
+
+    printf("%4s %4s", "M", "N");
+    for (i = 0; i < func_counter; i++)
+        printf("  %10s %5s", "misses", "ratio");
+    printf("\n");
+    for (i = 0; i < func_counter; i++)
+        printf("# %d: %s\n", i, func_list[i].description);
+
+    for (m = 0; m < nsizes; m++) {
+        for (n = 0; n < nsizes; n++) {
+            /* all squares, and a spread of rectangles */
+            if (m != n && (m + n) % 3 != 0)
+                continue;
+            /* a block has 2^b / 4 ints; rows need not be aligned */
+            double compulsory = 2.0 * sizes[m] * sizes[n] * sizeof(int) / (1 << b);
+
+            printf("%4d %4d", sizes[m], sizes[n]);
+            for (i = 0; i < func_counter; i++) {
+                cache = run_recorded(i, sizes[m], sizes[n], s, E, b);
+                if (!cache) {
+                    printf("  %10s %5s", "-", "-");
+                    continue;
+                }
+                printf("  %10ld %5.2f", cache->misses, cache->misses / compulsory);
+                cache_free(cache);
+            }
+            printf("\n");
+        }
+    }
+}
+
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-hp] -M <rows> -N <cols>\n", argv[0]);
+    printf("       %s -S\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
+    printf("  -p          Record accesses in process instead of with valgrind.\n");
+    printf("  -S          Sweep many shapes in process and print the misses.\n");
     printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
@@ -198,8 +360,10 @@ void sigalrm_handler(int signum){
 int main(int argc, char* argv[])
 {
     char c;
+    int inprocess = 0;
+    int sweep = 0;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:hpS")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -210,12 +374,23 @@ int main(int argc, char* argv[])
         case 'h':
             usage(argv);
             exit(0);
+        case 'p':
+            inprocess = 1;
+            break;
+        case 'S':
+            sweep = 1;
+            break;
         default:
             usage(argv);
             exit(1);
         }
     }
   
+    if (sweep) {
+        sweep_shapes(5, 1, 5);
+        return 0;
+    }
+
     if (M == 0 || N == 0) {
         printf("Error: Missing required argument\n");
         usage(argv);
@@ -243,7 +418,10 @@ int main(int argc, char* argv[])
     alarm(120);
 
     /* Check the performance of the student's transpose function */
-    eval_perf(5, 1, 5);
+    if (inprocess)
+        eval_perf_inprocess(5, 1, 5);
+    else
+        eval_perf(5, 1, 5);
   
     /* Emit the results for this particular test */
     if (results.funcid == -1) {
@@ -0,0 +1,360 @@
+/*
+ * trace.c - Readers for valgrind lackey memory traces
+ *
+ * The whole trace file is mapped into memory and scanned in place with
+ * a hand-written decoder, so reading a line costs no copies and no
+ * calls into libc. The access handed back by trace_next points into
+ * the mapping and stays valid until trace_close. Binary traces (see
+ * trace.h) are recognized by their header and decoded the same way.
+ *
+ * Pipes, FIFOs and stdin cannot be mapped. They are read through a
+ * bounded buffer instead: the decoders see only the complete lines
+ * (or, for binary traces, records) in it, and once those are used up
+ * the partial tail moves to the front and the buffer is refilled.
+ */
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define STREAM_BUF (1 << 20) /* bytes buffered when streaming */
+
+struct trace
+{
+    const char *data; /* the mapped file, or the stream buffer */
+    size_t size;
+    const char *pos;  /* start of the next line */
+    const char *end;  /* end of the data the decoders may use */
+    int binary;         /* a trace2bin file */
+    uint64_t prev_addr; /* binary traces: the last address decoded */
+
+    /* streams only */
+    int fd;              /* -1 for a mapped file */
+    const char *buf_end; /* end of the data read so far */
+    int eof;
+};
+
+static const char ops[] = "LSM";
+
+/*
+ * hex_value - Return the value of hex digit c, or -1 if c is not one
+ */
+static inline int hex_value(unsigned char c)
+{
+    if ((unsigned)(c - '0') < 10)
+        return c - '0';
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 6)
+        return c - 'a' + 10;
+    return -1;
+}
+
+/*
+ * refill - Keep the unread tail of the stream buffer, read more after
+ *     it until there is a complete line (or, if want is not 0, at least
+ *     want bytes), and move end past the last complete line (or to the
+ *     end of the data for binary traces and at end of file)
+ */
+static int refill(trace_t *trace, size_t want)
+{
+    char *buf = (char *)trace->data;
+    size_t keep = trace->buf_end - trace->pos;
+    size_t used;
+    ssize_t n;
+
+    memmove(buf, trace->pos, keep);
+    used = keep;
+    while (!trace->eof && used < STREAM_BUF)
+    {
+        n = read(trace->fd, buf + used, STREAM_BUF - used);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            trace->eof = 1;
+            if (n < 0)
+                return -1;
+            break;
+        }
+        used += n;
+        // a pipe delivers a bit at a time: go on once there is enough
+        if (want ? used >= want : memchr(buf + used - n, '\n', n) != NULL)
+            break;
+    }
+
+    trace->pos = buf;
+    trace->buf_end = buf + used;
+    trace->end = trace->buf_end;
+    if (!trace->eof && !trace->binary)
+    {
+        const char *p = trace->end;
+        while (p > buf && p[-1] != '\n')
+            p--;
+        // a line longer than the buffer is cut rather than stalling
+        if (p > buf || used < STREAM_BUF)
+            trace->end = p;
+    }
+    return 0;
+}
+
+/*
+ * open_stream - Set up reading fd through a buffer
+ */
+static int open_stream(trace_t *trace, int fd)
+{
+    trace->fd = fd;
+    trace->data = (const char *)malloc(STREAM_BUF);
+    if (!trace->data)
+        return -1;
+    trace->pos = trace->buf_end = trace->end = trace->data;
+
+    // read the fixed-size header to tell the formats apart
+    if (refill(trace, TRACE_BIN_MAGIC_LEN) < 0)
+        return -1;
+    if (trace->buf_end - trace->data >= TRACE_BIN_MAGIC_LEN &&
+        memcmp(trace->data, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_LEN) == 0)
+    {
+        trace->binary = 1;
+        trace->pos += TRACE_BIN_MAGIC_LEN;
+        trace->end = trace->buf_end;
+    }
+    return 0;
+}
+
+trace_t *trace_open(const char *path)
+{
+    trace_t *trace;
+    struct stat st;
+    int fd, saved;
+
+    if (strcmp(path, "-") == 0)
+        fd = STDIN_FILENO;
+    else if ((fd = open(path, O_RDONLY)) < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || (trace = (trace_t *)calloc(1, sizeof(trace_t))) == NULL)
+    {
+        saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+
+    if (!S_ISREG(st.st_mode))
+    {
+        if (open_stream(trace, fd) < 0)
+        {
+            saved = errno;
+            trace_close(trace);
+            errno = saved;
+            return NULL;
+        }
+        return trace;
+    }
+    trace->fd = -1;
+    trace->size = st.st_size;
+    if (trace->size > 0)
+    {
+        void *data = mmap(NULL, trace->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            saved = errno;
+            close(fd);
+            free(trace);
+            errno = saved;
+            return NULL;
+        }
+        madvise(data, trace->size, MADV_SEQUENTIAL);
+        trace->data = (const char *)data;
+    }
+    close(fd);
+    trace->pos = trace->data;
+    trace->end = trace->data + trace->size;
+    if (trace->size >= TRACE_BIN_MAGIC_LEN &&
+        memcmp(trace->data, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_LEN) == 0)
+    {
+        trace->binary = 1;
+        trace->pos += TRACE_BIN_MAGIC_LEN;
+    }
+    return trace;
+}
+
+/*
+ * get_varint - Decode a varint at *pp, or return -1 if it is cut short
+ */
+static inline int get_varint(const unsigned char **pp, const unsigned char *end,
+                             uint64_t *value)
+{
+    const unsigned char *p = *pp;
+    uint64_t v = 0;
+    int shift = 0;
+
+    while (p < end && shift < 64)
+    {
+        v |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80))
+        {
+            *value = v;
+            *pp = p;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+static int next_binary_record(trace_t *trace, trace_access_t *a)
+{
+    const unsigned char *p = (const unsigned char *)trace->pos;
+    const unsigned char *end = (const unsigned char *)trace->end;
+    uint64_t size, delta;
+    int op;
+
+    if (p >= end || (op = *p & 3) == 3)
+        return 0;
+    size = *p++ >> 2;
+    if (size == 63 && get_varint(&p, end, &size) < 0)
+        return 0;
+    if (get_varint(&p, end, &delta) < 0)
+        return 0;
+
+    // undo the zigzag encoding
+    trace->prev_addr += (delta >> 1) ^ -(delta & 1);
+    a->op = ops[op];
+    a->size = (int)size;
+    a->addr = trace->prev_addr;
+    a->line = NULL;
+    a->len = 0;
+    trace->pos = (const char *)p;
+    return 1;
+}
+
+static int next_binary(trace_t *trace, trace_access_t *a)
+{
+    // keep a whole record buffered, however little each read returns
+    if (trace->fd >= 0 && !trace->eof && trace->end - trace->pos < TRACE_BIN_MAX_RECORD &&
+        refill(trace, TRACE_BIN_MAX_RECORD) < 0)
+        return 0;
+    return next_binary_record(trace, a);
+}
+
+static int next_line(trace_t *trace, trace_access_t *a)
+{
+    const char *p = trace->pos, *end = trace->end;
+
+    while (p < end)
+    {
+        const char *line = p;
+        uint64_t addr = 0;
+        int size = 0, digit, ok = 0;
+
+        // data accesses look like " L 7ff000398,8"
+        if (*p == ' ' && end - p > 3 && p[2] == ' ')
+        {
+            char op = p[1];
+            p += 3;
+            while (p < end && *p == ' ')
+                p++;
+            while (p < end && (digit = hex_value(*p)) >= 0)
+            {
+                addr = addr << 4 | digit;
+                p++;
+                ok = 1;
+            }
+            if (p < end && *p == ',')
+            {
+                for (p++; p < end && (unsigned)(*p - '0') < 10; p++)
+                    size = size * 10 + (*p - '0');
+            }
+            if (ok && (op == 'L' || op == 'S' || op == 'M'))
+            {
+                a->op = op;
+                a->addr = addr;
+                a->size = size;
+                a->line = line;
+            }
+            else
+                ok = 0;
+        }
+
+        while (p < end && *p != '\n')
+            p++;
+        if (ok)
+        {
+            a->len = (int)(p - line);
+            trace->pos = p < end ? p + 1 : p;
+            return 1;
+        }
+        p++;
+    }
+    trace->pos = end;
+    return 0;
+}
+
+int trace_next(trace_t *trace, trace_access_t *a)
+{
+    if (trace->binary)
+        return next_binary(trace, a);
+    while (!next_line(trace, a))
+    {
+        if (trace->fd < 0 || trace->eof || refill(trace, 0) < 0)
+            return 0;
+    }
+    return 1;
+}
+
+int trace_is_stream(const trace_t *trace)
+{
+    return trace->fd >= 0;
+}
+
+static int put_varint(unsigned char *buf, uint64_t v)
+{
+    int n = 0;
+
+    while (v >= 0x80)
+    {
+        buf[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (unsigned char)v;
+    return n;
+}
+
+int trace_encode(unsigned char *buf, const trace_access_t *a, uint64_t *prev_addr)
+{
+    int64_t delta = (int64_t)(a->addr - *prev_addr);
+    int op = (int)(strchr(ops, a->op) - ops);
+    int n = 1;
+
+    if (a->size < 63)
+        buf[0] = (unsigned char)(op | a->size << 2);
+    else
+    {
+        buf[0] = (unsigned char)(op | 63 << 2);
+        n += put_varint(buf + n, (uint64_t)a->size);
+    }
+    n += put_varint(buf + n, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+    *prev_addr = a->addr;
+    return n;
+}
+
+void trace_close(trace_t *trace)
+{
+    if (!trace)
+        return;
+    if (trace->fd >= 0)
+    {
+        free((void *)trace->data);
+        if (trace->fd != STDIN_FILENO)
+            close(trace->fd);
+    }
+    else if (trace->size > 0)
+        munmap((void *)trace->data, trace->size);
+    free(trace);
+}
@@ -0,0 +1,72 @@
+/*
+ * trace.h - Readers for valgrind lackey memory traces
+ *
+ * A trace is a text file with one memory access per line:
+ *
+ *     I 0400d7d4,8
+ *      M 0421c7f0,4
+ *      L 04f6b868,8
+ *      S 7ff0005c8,8
+ *
+ * Data accesses start with a space; instruction loads ("I") and any
+ * other lines valgrind prints are skipped by trace_next.
+ *
+ * trace_open also reads the compact binary form written by trace2bin:
+ * the TRACE_BIN_MAGIC header followed by one variable-length record
+ * per data access,
+ *
+ *     byte 0   op in bits 0-1 (0 L, 1 S, 2 M), size in bits 2-7;
+ *              a size of 63 or more stores 63 and follows as a varint
+ *     varint   address minus the previous address, zigzag-encoded
+ *
+ * where a varint is 7 bits per byte, low bits first, with the top bit
+ * set on all but the last byte. Most accesses take 2 or 3 bytes.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    char op;          /* 'L', 'S' or 'M' */
+    int size;         /* bytes accessed */
+    uint64_t addr;    /* address of the first byte */
+    const char *line; /* the text of the line without the newline,
+                         or NULL for binary traces */
+    int len;          /* length of line */
+} trace_access_t;
+
+#define TRACE_BIN_MAGIC "CSIMBIN1"
+#define TRACE_BIN_MAGIC_LEN 8
+
+/* Longest binary record: the op byte and two 10-byte varints */
+#define TRACE_BIN_MAX_RECORD 21
+
+typedef struct trace trace_t;
+
+/*
+ * Open a trace file, or return NULL and set errno. A path of "-" reads
+ * stdin; stdin, pipes and FIFOs are streamed through a bounded buffer.
+ */
+trace_t *trace_open(const char *path);
+
+/*
+ * Read the next data access into a; returns 0 at the end of the trace.
+ * a->line stays valid until trace_close, or for a stream only until
+ * the next call.
+ */
+int trace_next(trace_t *trace, trace_access_t *a);
+
+/* Whether trace is streamed rather than mapped */
+int trace_is_stream(const trace_t *trace);
+
+void trace_close(trace_t *trace);
+
+/*
+ * Append the binary record of a to buf and return its length;
+ * *prev_addr is the address of the previous access (0 at the start)
+ */
+int trace_encode(unsigned char *buf, const trace_access_t *a, uint64_t *prev_addr);
+
+#endif /* TRACE_H */
@@ -0,0 +1,99 @@
+/*
+ * trace2bin.c - Convert valgrind traces to the binary format of trace.h
+ *
+ *     linux> ./trace2bin traces/long.trace long.bin
+ *     linux> ./csim -s 5 -E 1 -b 5 -t long.bin
+ *
+ * With -d, a binary trace is written back out as text instead, which
+ * csim replays the same way (addresses lose their leading zeros).
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+static const char *help_msg = "Usage: ./trace2bin [-h] <tracefile> <binfile>\n"
+                              "       ./trace2bin -d <binfile> [<tracefile>]\n"
+                              "   -h: Print this help message\n"
+                              "   -d: Decode a binary trace to text (default: stdout)\n";
+
+int main(int argc, char **argv)
+{
+    int opt, decode = 0;
+
+    while ((opt = getopt(argc, argv, "hd")) != -1)
+    {
+        switch (opt)
+        {
+        case 'h':
+            printf("%s", help_msg);
+            exit(EXIT_SUCCESS);
+        case 'd':
+            decode = 1;
+            break;
+        default:
+            printf("%s", help_msg);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (argc - optind != 2 && !(decode && argc - optind == 1))
+    {
+        printf("%s", help_msg);
+        exit(EXIT_FAILURE);
+    }
+
+    trace_t *trace = trace_open(argv[optind]);
+    if (!trace)
+    {
+        fprintf(stderr, "cannot open %s for reading\n", argv[optind]);
+        exit(EXIT_FAILURE);
+    }
+    FILE *out = argc - optind == 1 ? stdout : fopen(argv[optind + 1], "w");
+    if (!out)
+    {
+        fprintf(stderr, "cannot open %s for writing\n", argv[optind + 1]);
+        exit(EXIT_FAILURE);
+    }
+
+    trace_access_t access;
+    unsigned long count = 0, bytes = 0;
+    if (decode)
+    {
+        while (trace_next(trace, &access))
+        {
+            fprintf(out, " %c %llx,%d\n", access.op, (unsigned long long)access.addr,
+                    access.size);
+            count++;
+        }
+    }
+    else
+    {
+        unsigned char buf[TRACE_BIN_MAX_RECORD];
+        uint64_t prev_addr = 0;
+        int len;
+
+        fwrite(TRACE_BIN_MAGIC, 1, TRACE_BIN_MAGIC_LEN, out);
+        bytes = TRACE_BIN_MAGIC_LEN;
+        while (trace_next(trace, &access))
+        {
+            len = trace_encode(buf, &access, &prev_addr);
+            fwrite(buf, 1, len, out);
+            bytes += len;
+            count++;
+        }
+    }
+
+    trace_close(trace);
+    if (fclose(out) != 0)
+    {
+        perror("trace2bin");
+        exit(EXIT_FAILURE);
+    }
+    if (!decode)
+        fprintf(stderr, "%lu accesses, %lu bytes (%.2f bytes per access)\n", count, bytes,
+                count ? (double)bytes / count : 0.0);
+    return 0;
+}
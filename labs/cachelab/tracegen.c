@@ -4,14 +4,22 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are recorded in file for later use, followed by the
+ * address ranges of the matrices A and B.
+ *
+ * A and B are allocated for the size asked, at any size. By default B
+ * lies 256KB (or a multiple) after A, as with the static 256x256
+ * arrays tracegen used to have, so the lab's cache sees the same sets;
+ * -a changes the alignment of both and -H backs them with huge pages.
  */
-
+#define _GNU_SOURCE /* for MAP_ANONYMOUS, MAP_HUGETLB and madvise */
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <assert.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <sys/mman.h>
 #include "cachelab.h"
 #include <string.h>
 
@@ -25,20 +33,75 @@ extern void registerFunctions();
 /* Markers used to bound trace regions of interest */
 volatile char MARKER_START, MARKER_END;
 
-static int A[256][256];
-static int B[256][256];
+/* B starts a multiple of this many bytes after A */
+#define MATRIX_SPACING (256 * 256 * sizeof(int))
+
+/* Default alignment of A and B: a cache line */
+#define DEFAULT_ALIGN 64
+
+/* Size of the huge pages asked for with -H */
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+static int *A;
+static int *B;
 static int M;
 static int N;
 
+static size_t round_up(size_t x, size_t align)
+{
+    return (x + align - 1) / align * align;
+}
+
+/*
+ * alloc_matrices - Allocate A and B in one buffer, both aligned to
+ *     align bytes; with huge, the buffer is backed by huge pages if
+ *     any are reserved, and else asks for transparent ones
+ */
+int alloc_matrices(size_t align, int huge)
+{
+    size_t bytes = (size_t)M * N * sizeof(int);
+    size_t spacing, total;
+    void *buf;
+
+    if (huge && align < HUGE_PAGE_SIZE)
+        align = HUGE_PAGE_SIZE;
+    spacing = round_up(round_up(bytes, MATRIX_SPACING), align);
+    total = spacing + bytes;
+
+    if (huge) {
+        total = round_up(total, HUGE_PAGE_SIZE);
+        /* Huge pages only come 2MB aligned: over-allocate for more */
+        buf = mmap(NULL, round_up(total + align - HUGE_PAGE_SIZE, HUGE_PAGE_SIZE),
+                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (buf != MAP_FAILED) {
+            buf = (void *)round_up((uintptr_t)buf, align);
+        } else {
+            /* Over-allocate to align the buffer ourselves */
+            buf = mmap(NULL, total + align, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (buf == MAP_FAILED)
+                return -1;
+            buf = (void *)round_up((uintptr_t)buf, align);
+            if (madvise(buf, total, MADV_HUGEPAGE) != 0)
+                fprintf(stderr, "Warning: huge pages are not available, using normal pages\n");
+        }
+    } else if (posix_memalign(&buf, align, total) != 0) {
+        return -1;
+    }
+    A = (int *)buf;
+    B = (int *)((char *)buf + spacing);
+    return 0;
+}
 
+/*
+ * validate - Compare B with the transpose of A as it goes, without a
+ *     copy of the expected result, so any size can be checked
+ */
 int validate(int fn,int M, int N, int A[N][M], int B[M][N]) {
-    int C[M][N];
-    memset(C,0,sizeof(C));
-    correctTrans(M,N,A,C);
     for(int i=0;i<M;i++) {
         for(int j=0;j<N;j++) {
-            if(B[i][j]!=C[i][j]) {
-                printf("Validation failed on function %d! Expected %d but got %d at B[%d][%d]\n",fn,C[i][j],B[i][j],i,j);
+            if(B[i][j]!=A[j][i]) {
+                printf("Validation failed on function %d! Expected %d but got %d at B[%d][%d]\n",fn,A[j][i],B[i][j],i,j);
                 return 0;
             }
         }
@@ -51,7 +114,9 @@ int main(int argc, char* argv[]){
 
     char c;
     int selectedFunc=-1;
-    while( (c=getopt(argc,argv,"M:N:F:")) != -1){
+    size_t align = DEFAULT_ALIGN;
+    int huge = 0;
+    while( (c=getopt(argc,argv,"M:N:F:a:H")) != -1){
         switch(c){
         case 'M':
             M = atoi(optarg);
@@ -62,6 +127,12 @@ int main(int argc, char* argv[]){
         case 'F':
             selectedFunc = atoi(optarg);
             break;
+        case 'a':
+            align = strtoul(optarg, NULL, 0);
+            break;
+        case 'H':
+            huge = 1;
+            break;
         case '?':
         default:
             printf("./tracegen failed to parse its options.\n");
@@ -70,11 +141,27 @@ int main(int argc, char* argv[]){
     }
   
 
+    if (M <= 0 || N <= 0) {
+        printf("./tracegen needs -M and -N.\n");
+        exit(1);
+    }
+    if (align == 0 || (align & (align - 1)) != 0) {
+        printf("./tracegen: the alignment must be a power of two.\n");
+        exit(1);
+    }
+    /* posix_memalign takes nothing finer */
+    if (align < sizeof(void *))
+        align = sizeof(void *);
+    if (alloc_matrices(align, huge) < 0) {
+        printf("./tracegen cannot allocate %dx%d matrices.\n", M, N);
+        exit(1);
+    }
+
     /*  Register transpose functions */
     registerFunctions();
 
     /* Fill A with data */
-    initMatrix(M,N, A, B); 
+    initMatrix(M,N, (int (*)[M])A, (int (*)[N])B); 
 
     /* Record marker addresses */
     FILE* marker_fp = fopen(".marker","w");
@@ -82,22 +169,26 @@ int main(int argc, char* argv[]){
     fprintf(marker_fp, "%llx %llx", 
             (unsigned long long int) &MARKER_START,
             (unsigned long long int) &MARKER_END );
+    /* ... and the ranges of the matrices, for csim -A */
+    fprintf(marker_fp, "\nA %llx +%lx\nB %llx +%lx\n",
+            (unsigned long long int) A, (unsigned long) ((size_t)N * M * sizeof(int)),
+            (unsigned long long int) B, (unsigned long) ((size_t)M * N * sizeof(int)));
     fclose(marker_fp);
 
     if (-1==selectedFunc) {
         /* Invoke registered transpose functions */
         for (i=0; i < func_counter; i++) {
             MARKER_START = 33;
-            (*func_list[i].func_ptr)(M, N, A, B);
+            (*func_list[i].func_ptr)(M, N, (int (*)[M])A, (int (*)[N])B);
             MARKER_END = 34;
-            if (!validate(i,M,N,A,B))
+            if (!validate(i,M,N,(int (*)[M])A,(int (*)[N])B))
                 return i+1;
         }
     } else {
         MARKER_START = 33;
-        (*func_list[selectedFunc].func_ptr)(M, N, A, B);
+        (*func_list[selectedFunc].func_ptr)(M, N, (int (*)[M])A, (int (*)[N])B);
         MARKER_END = 34;
-        if (!validate(selectedFunc,M,N,A,B))
+        if (!validate(selectedFunc,M,N,(int (*)[M])A,(int (*)[N])B))
             return selectedFunc+1;
 
     }
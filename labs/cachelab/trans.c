@@ -10,8 +10,16 @@
 #include <stdio.h>
 #include "cachelab.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_SIMD_TRANSPOSE
+#endif
+
 int is_transpose(int M, int N, int A[N][M], int B[M][N]);
 void trans(int M, int N, int A[N][M], int B[M][N]);
+void transpose_recursive(int M, int N, int A[N][M], int B[M][N]);
+void transpose_simd(int M, int N, int A[N][M], int B[M][N]);
+void transpose_columns(int M, int N, int A[N][M], int B[M][N], int c0, int c1);
 
 void transpose_32_by_32(int M, int N, int A[N][M], int B[M][N])
 {
@@ -120,6 +128,28 @@ void transpose_61_by_67(int M, int N, int A[N][M], int B[M][N])
     }
 }
 
+/*
+ * transpose_blocked - Any other shape, in 8x8 blocks: a row of a block
+ *     fills one 32-byte line of A and a column one line per row of B
+ */
+void transpose_blocked(int M, int N, int A[N][M], int B[M][N])
+{
+    int row, col, r, c;
+    for (row = 0; row < N; row += 8)
+    {
+        for (col = 0; col < M; col += 8)
+        {
+            for (r = row; r < row + 8 && r < N; r++)
+            {
+                for (c = col; c < col + 8 && c < M; c++)
+                {
+                    B[c][r] = A[r][c];
+                }
+            }
+        }
+    }
+}
+
 /*
  * transpose_submit - This is the solution transpose function that you
  *     will be graded on for Part B of the assignment. Do not change
@@ -130,21 +160,15 @@ void transpose_61_by_67(int M, int N, int A[N][M], int B[M][N])
 char transpose_submit_desc[] = "Transpose submission";
 void transpose_submit(int M, int N, int A[N][M], int B[M][N])
 {
-    switch (M)
-    {
-    case 32:
+    // the tuned kernels only handle their own shapes
+    if (M == 32 && N == 32)
         transpose_32_by_32(M, N, A, B);
-        break;
-    case 64:
+    else if (M == 64 && N == 64)
         transpose_64_by_64(M, N, A, B);
-        break;
-    case 61:
+    else if (M == 61 && N == 67)
         transpose_61_by_67(M, N, A, B);
-        break;
-    default:
-        trans(M, N, A, B);
-        break;
-    }
+    else
+        transpose_blocked(M, N, A, B);
 }
 
 /*
@@ -170,6 +194,234 @@ void trans(int M, int N, int A[N][M], int B[M][N])
     }
 }
 
+/*
+ * transpose_block - Transpose rows [r0, r1) and columns [c0, c1) of A
+ *     by recursively halving the longer side, so that at some depth
+ *     the block fits in any cache without depending on its geometry
+ */
+static void transpose_block(int M, int N, int A[N][M], int B[M][N],
+                            int r0, int r1, int c0, int c1)
+{
+    int r, c, a0, a1, a2, a3, a4, a5, a6, a7;
+
+    if (r1 - r0 > 8 || c1 - c0 > 8)
+    {
+        if (r1 - r0 >= c1 - c0)
+        {
+            transpose_block(M, N, A, B, r0, (r0 + r1) / 2, c0, c1);
+            transpose_block(M, N, A, B, (r0 + r1) / 2, r1, c0, c1);
+        }
+        else
+        {
+            transpose_block(M, N, A, B, r0, r1, c0, (c0 + c1) / 2);
+            transpose_block(M, N, A, B, r0, r1, (c0 + c1) / 2, c1);
+        }
+        return;
+    }
+
+    // the recursion stops at 8 x 8 only to bound the call overhead
+    if (c1 - c0 < 8)
+    {
+        for (r = r0; r < r1; r++)
+            for (c = c0; c < c1; c++)
+                B[c][r] = A[r][c];
+        return;
+    }
+    // read a whole row before writing, so that a row of A and a row
+    // of B that map to the same set do not keep evicting each other
+    for (r = r0; r < r1; r++)
+    {
+        a0 = A[r][c0];
+        a1 = A[r][c0 + 1];
+        a2 = A[r][c0 + 2];
+        a3 = A[r][c0 + 3];
+        a4 = A[r][c0 + 4];
+        a5 = A[r][c0 + 5];
+        a6 = A[r][c0 + 6];
+        a7 = A[r][c0 + 7];
+        B[c0][r] = a0;
+        B[c0 + 1][r] = a1;
+        B[c0 + 2][r] = a2;
+        B[c0 + 3][r] = a3;
+        B[c0 + 4][r] = a4;
+        B[c0 + 5][r] = a5;
+        B[c0 + 6][r] = a6;
+        B[c0 + 7][r] = a7;
+    }
+}
+
+/*
+ * transpose_recursive - Cache-oblivious transpose for any M and N. It
+ *     adapts to the cache size, but not to conflicts: when rows are a
+ *     multiple of the cache way size apart (64 x 64 on the 1KB cache),
+ *     blocks of A and B collide and a tuned kernel does far better.
+ */
+char transpose_recursive_desc[] = "Cache-oblivious recursive transpose";
+void transpose_recursive(int M, int N, int A[N][M], int B[M][N])
+{
+    transpose_block(M, N, A, B, 0, N, 0, M);
+}
+
+#ifdef HAVE_SIMD_TRANSPOSE
+/*
+ * transpose_4x4_sse - Transpose the 4 x 4 tile at a (rows lda ints
+ *     apart) into b (rows ldb ints apart) with two rounds of unpacks
+ */
+static void transpose_4x4_sse(const int *a, int lda, int *b, int ldb)
+{
+    __m128i r0 = _mm_loadu_si128((const __m128i *)(a + 0 * lda));
+    __m128i r1 = _mm_loadu_si128((const __m128i *)(a + 1 * lda));
+    __m128i r2 = _mm_loadu_si128((const __m128i *)(a + 2 * lda));
+    __m128i r3 = _mm_loadu_si128((const __m128i *)(a + 3 * lda));
+
+    // interleave pairs of rows: t0 = a00 a10 a01 a11, ...
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    _mm_storeu_si128((__m128i *)(b + 0 * ldb), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(b + 1 * ldb), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(b + 2 * ldb), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i *)(b + 3 * ldb), _mm_unpackhi_epi64(t2, t3));
+}
+
+/*
+ * transpose_8x8_avx2 - Transpose an 8 x 8 tile: unpacks transpose the
+ *     4 x 4 quarters within each 128-bit lane, and a final lane
+ *     permute swaps the two off-diagonal quarters
+ */
+__attribute__((target("avx2"))) static void transpose_8x8_avx2(const int *a, int lda, int *b,
+                                                              int ldb)
+{
+    __m256i r0 = _mm256_loadu_si256((const __m256i *)(a + 0 * lda));
+    __m256i r1 = _mm256_loadu_si256((const __m256i *)(a + 1 * lda));
+    __m256i r2 = _mm256_loadu_si256((const __m256i *)(a + 2 * lda));
+    __m256i r3 = _mm256_loadu_si256((const __m256i *)(a + 3 * lda));
+    __m256i r4 = _mm256_loadu_si256((const __m256i *)(a + 4 * lda));
+    __m256i r5 = _mm256_loadu_si256((const __m256i *)(a + 5 * lda));
+    __m256i r6 = _mm256_loadu_si256((const __m256i *)(a + 6 * lda));
+    __m256i r7 = _mm256_loadu_si256((const __m256i *)(a + 7 * lda));
+
+    __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+    __m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+    __m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+    __m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+    __m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+    r0 = _mm256_unpacklo_epi64(t0, t2);
+    r1 = _mm256_unpackhi_epi64(t0, t2);
+    r2 = _mm256_unpacklo_epi64(t1, t3);
+    r3 = _mm256_unpackhi_epi64(t1, t3);
+    r4 = _mm256_unpacklo_epi64(t4, t6);
+    r5 = _mm256_unpackhi_epi64(t4, t6);
+    r6 = _mm256_unpacklo_epi64(t5, t7);
+    r7 = _mm256_unpackhi_epi64(t5, t7);
+
+    _mm256_storeu_si256((__m256i *)(b + 0 * ldb), _mm256_permute2x128_si256(r0, r4, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 1 * ldb), _mm256_permute2x128_si256(r1, r5, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 2 * ldb), _mm256_permute2x128_si256(r2, r6, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 3 * ldb), _mm256_permute2x128_si256(r3, r7, 0x20));
+    _mm256_storeu_si256((__m256i *)(b + 4 * ldb), _mm256_permute2x128_si256(r0, r4, 0x31));
+    _mm256_storeu_si256((__m256i *)(b + 5 * ldb), _mm256_permute2x128_si256(r1, r5, 0x31));
+    _mm256_storeu_si256((__m256i *)(b + 6 * ldb), _mm256_permute2x128_si256(r2, r6, 0x31));
+    _mm256_storeu_si256((__m256i *)(b + 7 * ldb), _mm256_permute2x128_si256(r3, r7, 0x31));
+}
+#endif
+
+typedef void (*tile_kernel_t)(const int *a, int lda, int *b, int ldb);
+
+/*
+ * transpose_8x8_scalar - The tile kernel for CPUs without SIMD
+ */
+static void transpose_8x8_scalar(const int *a, int lda, int *b, int ldb)
+{
+    int r, c;
+
+    for (r = 0; r < 8; r++)
+        for (c = 0; c < 8; c++)
+            b[c * ldb + r] = a[r * lda + c];
+}
+
+/*
+ * pick_kernel - The fastest tile kernel the CPU supports, and its size
+ */
+static tile_kernel_t pick_kernel(int *size)
+{
+#ifdef HAVE_SIMD_TRANSPOSE
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *size = 8;
+        return transpose_8x8_avx2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *size = 4;
+        return transpose_4x4_sse;
+    }
+#endif
+    *size = 8;
+    return transpose_8x8_scalar;
+}
+
+/*
+ * transpose_tiles - Transpose columns [c0, c1) of A with kernel on
+ *     size x size tiles, a band of rows at a time, and the ragged right
+ *     and bottom edges with plain loops. (Visiting the tiles in
+ *     recursive order runs slower: the hardware prefetchers follow the
+ *     reads of A along the band.)
+ */
+static void transpose_tiles(int M, int N, int A[N][M], int B[M][N], int c0, int c1, int size,
+                            tile_kernel_t kernel)
+{
+    int row, col, r, c;
+    int rows = N - N % size, cols = c1 - (c1 - c0) % size;
+
+    for (row = 0; row < rows; row += size)
+    {
+        for (col = c0; col < cols; col += size)
+            kernel(&A[row][col], M, &B[col][row], N);
+        for (r = row; r < row + size; r++)
+            for (c = cols; c < c1; c++)
+                B[c][r] = A[r][c];
+    }
+    for (r = rows; r < N; r++)
+        for (c = c0; c < c1; c++)
+            B[c][r] = A[r][c];
+}
+
+/*
+ * transpose_simd - Transpose with 8 x 8 AVX2 or 4 x 4 SSE tiles,
+ *     whichever the CPU supports, or else transpose_recursive
+ */
+char transpose_simd_desc[] = "SIMD register-tile transpose";
+void transpose_simd(int M, int N, int A[N][M], int B[M][N])
+{
+    int size;
+    tile_kernel_t kernel = pick_kernel(&size);
+
+    if (kernel == transpose_8x8_scalar)
+        transpose_recursive(M, N, A, B);
+    else
+        transpose_tiles(M, N, A, B, 0, M, size, kernel);
+}
+
+/*
+ * transpose_columns - Transpose columns [c0, c1) of A into rows
+ *     [c0, c1) of B with the fastest tile kernel; ptrans.c splits a
+ *     transpose across threads with it
+ */
+void transpose_columns(int M, int N, int A[N][M], int B[M][N], int c0, int c1)
+{
+    int size;
+    tile_kernel_t kernel = pick_kernel(&size);
+
+    transpose_tiles(M, N, A, B, c0, c1, size, kernel);
+}
+
 /*
  * registerFunctions - This function registers your transpose
  *     functions with the driver.  At runtime, the driver will
@@ -184,6 +436,8 @@ void registerFunctions()
 
     /* Register any additional transpose functions */
     // registerTransFunction(trans, trans_desc);
+    registerTransFunction(transpose_recursive, transpose_recursive_desc);
+    registerTransFunction(transpose_simd, transpose_simd_desc);
 }
 
 /*
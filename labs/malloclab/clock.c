@@ -267,6 +267,18 @@ static void callibrate(int verbose)
 
 static clock_t start_tick = 0;
 
+/*
+ * init_comp_counter - Calibrate up front, retrying if no timer event
+ *     was seen, so that processes forked later inherit the result
+ */
+void init_comp_counter()
+{
+    int tries;
+
+    for (tries = 0; cyc_per_tick == 0.0 && tries < 5; tries++)
+	callibrate(0);
+}
+
 void start_comp_counter() 
 {
     struct tms t;
@@ -17,6 +17,8 @@ double mhz_full(int verbose, int sleeptime);
 
 /** Special counters that compensate for timer interrupt overhead */
 
+void init_comp_counter();
+
 void start_comp_counter();
 
 double get_comp_counter();
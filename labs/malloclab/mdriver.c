@@ -18,13 +18,16 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/wait.h>
 
 
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "clock.h"
 #include "config.h"
 #include "driverlib.h"
+#include "stree.h"
 
 /**********************
  * Constants and macros
@@ -49,14 +52,28 @@
  * Remember that index (-1) is the null pointer.
  */
 
-/* Records the extent of each block's payload */
+/*
+ * Records the extent of each block's payload.
+ * Organized as a doubly linked list in address order.
+ */
 typedef struct range_t {
 	char *lo;              /* low payload address */
 	char *hi;              /* high payload address */
-	struct range_t *next;  /* next list element */
+	struct range_t *next;  /* next block up in memory */
+	struct range_t *prev;  /* next block down in memory */
 	int index;             /* same index as free; for debugging */
 } range_t;
 
+/*
+ * All information about the set of ranges: the sorted list, plus a
+ * splay tree keyed by lo addresses to find a block's neighbors in
+ * O(log n) amortized time, as in the rec11 driver
+ */
+typedef struct {
+	range_t *list;
+	tree_t *lo_tree;
+} range_set_t;
+
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
 	enum { ALLOC, FREE, REALLOC } type; /* type of request */
@@ -67,7 +84,7 @@ typedef struct {
 /* Holds the information for one trace file*/
 typedef struct {
 	char filename[MAXLINE];
-	int ignore_ranges;   /* don't check ranges (i.e. this is too big) */
+	int ignore_ranges;   /* unused: range checks are cheap with range_set_t */
 	int num_ids;         /* number of alloc/realloc ids */
 	int num_ops;         /* number of distinct requests */
 	int weight;          /* weight for this trace (unused) */
@@ -84,7 +101,7 @@ typedef struct {
  */
 typedef struct {
 	trace_t *trace;
-	range_t *ranges;
+	range_set_t *ranges;
 } speed_t;
 
 /* Summarizes the important stats for some malloc function on some trace */
@@ -104,6 +121,19 @@ typedef struct {
 	/* Note: secs and util are only defined if valid is true */
 } stats_t;
 
+/* One point of the fragmentation timeline (-T), taken every
+   sample_interval requests while eval_mm_util runs a trace */
+typedef struct {
+	int op;              /* number of requests done so far */
+	size_t live;         /* payload bytes the trace has allocated */
+	size_t heapsize;     /* size of the heap */
+	int walked;          /* are the fields below known (mm_heapwalk)? */
+	size_t free_bytes;   /* bytes in free blocks */
+	size_t largest_free; /* size of the largest free block */
+	int free_blocks;     /* number of free blocks */
+	int alloc_blocks;    /* number of allocated blocks */
+} sample_t;
+
 
 /********************
  * For debugging.  If debug-mode is on, then we have each block start
@@ -133,6 +163,18 @@ int onetime_flag = 0;
 static int set_timeout = 0;
 
 
+/* Number of traces evaluated at once, each in its own process (-j) */
+static int jobs = 1;
+
+/* Fragmentation timeline (-T), written as JSON or CSV */
+static FILE *timeline_fp = NULL;
+static int timeline_json = 0;
+static int timeline_count = 0;  /* traces written so far */
+static int sample_interval = 100;
+
+/* Not every mm-*.c implements the heap walk */
+#pragma weak mm_heapwalk
+
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
@@ -148,11 +190,12 @@ char autoresult[SUBMITR_MAXBUF]; /* autoresult string */
  * Function prototypes
  *********************/
 
-/* these functions manipulate range lists */
-static int add_range(range_t **ranges, char *lo, int size,
+/* these functions manipulate range sets */
+static range_set_t *new_range_set(void);
+static int add_range(range_set_t *ranges, char *lo, int size,
 		const trace_t *trace, int opnum, int index);
-static void remove_range(range_t **ranges, char *lo);
-static void clear_ranges(range_t **ranges);
+static void remove_range(range_set_t *ranges, char *lo);
+static void clear_ranges(range_set_t *ranges);
 
 /* These functions implement the debugging code */
 static void init_random_data(void);
@@ -171,10 +214,14 @@ static void eval_libc_speed(void *ptr);
 
 /* Routines for evaluating correctnes, space utilization, and speed
    of the student's malloc package in mm.c */
-static int eval_mm_valid(trace_t *trace, range_t **ranges);
+static int eval_mm_valid(trace_t *trace, range_set_t *ranges);
 static double eval_mm_util(trace_t *trace, int tracenum);
 static void eval_mm_speed(void *ptr);
 
+/* These functions record the fragmentation timeline */
+static void take_sample(sample_t *sample, int op, size_t live);
+static void write_timeline(const char *filename, sample_t *samples, int n);
+
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
 static void usage(void);
@@ -192,14 +239,24 @@ static void app_error(const char *fmt, ...)
 		longjmp(timeout_jmpbuf, 1);
 	}
 
+static void run_tests_parallel(int num_tracefiles, const char *tracedir,
+		char **tracefiles,
+		stats_t *mm_stats, range_set_t *ranges, speed_t *speed_params);
+
 /* Run the tests; return the number of tests run (may be less than
    num_tracefiles, if there's a timeout) */
 static void run_tests(int num_tracefiles, const char *tracedir,
 		char **tracefiles, 
-		stats_t *mm_stats, range_t *ranges, speed_t *speed_params) {
+		stats_t *mm_stats, range_set_t *ranges, speed_t *speed_params) {
 	volatile int i;
 	volatile int timed_out = 0;
 
+	if (jobs > 1 && num_tracefiles > 1 && !onetime_flag) {
+		run_tests_parallel(num_tracefiles, tracedir, tracefiles, mm_stats,
+				ranges, speed_params);
+		return;
+	}
+
 	for (i=0; i < num_tracefiles; i++) {
 		/* handle timeouts */
 		if(setjmp(timeout_jmpbuf) != 0) {
@@ -215,7 +272,7 @@ static void run_tests(int num_tracefiles, const char *tracedir,
 		} else {
 			if (verbose > 1)
 				printf("Checking mm_malloc for correctness, ");
-			mm_stats[i].valid = eval_mm_valid(trace, &ranges);
+			mm_stats[i].valid = eval_mm_valid(trace, ranges);
 
 			if (onetime_flag) {
 				free_trace(trace);
@@ -236,6 +293,135 @@ static void run_tests(int num_tracefiles, const char *tracedir,
 	}
 }
 
+/*
+ * run_tests_parallel - Evaluate up to jobs traces at once. Each trace
+ *     runs in a forked worker with a private copy of the simulated heap,
+ *     and sends its stats back through a pipe; the parent stores them
+ *     by trace number, so results come out in the usual order. Since
+ *     the workers share the machine, throughput is noisier than in a
+ *     sequential run. A timeout (-s) applies to each trace separately.
+ */
+static void run_tests_parallel(int num_tracefiles, const char *tracedir,
+		char **tracefiles,
+		stats_t *mm_stats, range_set_t *ranges, speed_t *speed_params)
+{
+	/* What a worker sends back for its trace */
+	typedef struct {
+		stats_t stats;
+		int errors;
+	} result_t;
+
+	pid_t *pids;      /* worker running each trace, 0 when done */
+	int *fds;         /* read end of each worker's result pipe */
+	FILE **timelines; /* each worker's share of the timeline, if any */
+	int next = 0, running = 0, done = 0, status, i, fd[2];
+	result_t result;
+	pid_t pid;
+	char buf[MAXLINE];
+	size_t n;
+
+	pids = calloc(num_tracefiles, sizeof(pid_t));
+	fds = calloc(num_tracefiles, sizeof(int));
+	timelines = calloc(num_tracefiles, sizeof(FILE *));
+	if (pids == NULL || fds == NULL || timelines == NULL)
+		unix_error("calloc failed in run_tests_parallel");
+
+	/* the workers time themselves */
+	alarm(0);
+
+#if USE_FCYC
+	/* calibrate the cycle counter here, or every worker would spend a
+	   second doing it */
+	init_comp_counter();
+#endif
+
+	while (done < num_tracefiles) {
+		/* keep up to jobs workers busy */
+		while (running < jobs && next < num_tracefiles) {
+			if (pipe(fd) < 0)
+				unix_error("pipe failed in run_tests_parallel");
+			if (timeline_fp != NULL && (timelines[next] = tmpfile()) == NULL)
+				unix_error("tmpfile failed in run_tests_parallel");
+
+			if ((pid = fork()) < 0)
+				unix_error("fork failed in run_tests_parallel");
+			if (pid == 0) {
+				close(fd[0]);
+				if (timeline_fp != NULL) {
+					timeline_fp = timelines[next];
+					timeline_count = 0;
+				}
+				errors = 0;
+				if (set_timeout)
+					alarm(set_timeout);
+				jobs = 1;
+				run_tests(1, tracedir, &tracefiles[next], &mm_stats[next],
+						ranges, speed_params);
+				result.stats = mm_stats[next];
+				result.errors = errors;
+				if (timeline_fp != NULL)
+					fflush(timeline_fp);
+				if (write(fd[1], &result, sizeof(result)) != sizeof(result))
+					_exit(1);
+				_exit(0);
+			}
+			close(fd[1]);
+			pids[next] = pid;
+			fds[next] = fd[0];
+			next++;
+			running++;
+		}
+
+		/* collect whichever worker finishes first */
+		if ((pid = wait(&status)) < 0)
+			unix_error("wait failed in run_tests_parallel");
+		for (i = 0; i < next && pids[i] != pid; i++)
+			;
+		if (i == next)
+			continue;
+		pids[i] = 0;
+		running--;
+		done++;
+
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+				read(fds[i], &result, sizeof(result)) == sizeof(result)) {
+			mm_stats[i] = result.stats;
+			errors += result.errors;
+		} else {
+			/* the allocator crashed the worker */
+			strcpy(mm_stats[i].filename, tracedir);
+			strcat(mm_stats[i].filename, tracefiles[i]);
+			mm_stats[i].valid = 0;
+			errors++;
+			printf("ERROR [trace %s]: worker died (%s %d)\n",
+					mm_stats[i].filename,
+					WIFSIGNALED(status) ? "signal" : "status",
+					WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+		}
+		close(fds[i]);
+	}
+
+	/* stitch the timeline together in trace order */
+	for (i = 0; i < num_tracefiles; i++) {
+		if (timelines[i] == NULL)
+			continue;
+		rewind(timelines[i]);
+		if ((n = fread(buf, 1, sizeof(buf), timelines[i])) > 0) {
+			if (timeline_json && timeline_count > 0)
+				fputc(',', timeline_fp);
+			timeline_count++;
+			do {
+				fwrite(buf, 1, n, timeline_fp);
+			} while ((n = fread(buf, 1, sizeof(buf), timelines[i])) > 0);
+		}
+		fclose(timelines[i]);
+	}
+
+	free(pids);
+	free(fds);
+	free(timelines);
+}
+
 /**************
  * Main routine
  **************/
@@ -246,7 +432,7 @@ int main(int argc, char **argv)
 	char **tracefiles = NULL;  /* null-terminated array of trace file names */
 	int num_tracefiles = 0;    /* the number of traces in that array */
 
-	range_t *ranges = NULL;    /* keeps track of block extents for one trace */
+	range_set_t *ranges;       /* keeps track of block extents for one trace */
 	stats_t *libc_stats = NULL;/* libc stats for each trace */
 	stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
 	speed_t speed_params;      /* input parameters to the xx_speed routines */
@@ -266,7 +452,7 @@ int main(int argc, char **argv)
 	/*
 	 * Read and interpret the command line arguments
 	 */
-	while ((c = getopt(argc, argv, "d:f:c:s:t:v:hVAlD")) != EOF) {
+	while ((c = getopt(argc, argv, "d:f:c:i:j:s:t:T:v:hVAlD")) != EOF) {
 		switch (c) {
 
 			case 'A': /* Hidden Autolab driver argument */
@@ -324,6 +510,25 @@ int main(int argc, char **argv)
 				set_timeout = atoi(optarg);
 				break;
 
+			case 'T': /* Write a fragmentation timeline to a file */
+				if ((timeline_fp = fopen(optarg, "w")) == NULL)
+					unix_error("Could not open %s", optarg);
+				timeline_json = strlen(optarg) > 5 &&
+					strcmp(optarg + strlen(optarg) - 5, ".json") == 0;
+				break;
+
+			case 'j': /* Evaluate this many traces in parallel */
+				jobs = atoi(optarg);
+				if (jobs <= 0)
+					jobs = sysconf(_SC_NPROCESSORS_ONLN);
+				break;
+
+			case 'i': /* Timeline sampling interval, in requests */
+				sample_interval = atoi(optarg);
+				if (sample_interval <= 0)
+					app_error("-i needs a positive number of requests\n");
+				break;
+
 			case 'h': /* Print this message */
 				usage();
 				exit(0);
@@ -401,6 +606,15 @@ int main(int argc, char **argv)
 
 	/* Initialize the simulated memory system in memlib.c */
 	mem_init();
+	ranges = new_range_set();
+
+	if (timeline_fp != NULL) {
+		if (timeline_json)
+			fprintf(timeline_fp, "[");
+		else
+			fprintf(timeline_fp, "trace,op,live_bytes,heap_bytes,util,"
+					"free_bytes,largest_free,free_blocks,alloc_blocks\n");
+	}
 
 	run_tests(num_tracefiles, tracedir, tracefiles, mm_stats,
 			ranges, &speed_params);
@@ -422,6 +636,12 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (timeline_fp != NULL) {
+		if (timeline_json)
+			fprintf(timeline_fp, "\n]\n");
+		fclose(timeline_fp);
+	}
+
 	/*
 	 * Accumulate the aggregate statistics for the student's mm package
 	 */
@@ -496,22 +716,36 @@ int main(int argc, char **argv)
 
 
 /*****************************************************************
- * The following routines manipulate the range list, which keeps
+ * The following routines manipulate the range set, which keeps
  * track of the extent of every allocated block payload. We use the
- * range list to detect any overlapping allocated blocks.
+ * range set to detect any overlapping allocated blocks.
  ****************************************************************/
 
+/*
+ * new_range_set - Create an empty range set
+ */
+static range_set_t *new_range_set(void)
+{
+	range_set_t *ranges;
+
+	if ((ranges = (range_set_t *)malloc(sizeof(range_set_t))) == NULL)
+		unix_error("malloc error in new_range_set");
+	ranges->list = NULL;
+	ranges->lo_tree = tree_new();
+	return ranges;
+}
+
 /*
  * add_range - As directed by request opnum in trace tracenum,
  *     we've just called the student's mm_malloc to allocate a block of
  *     size bytes at addr lo. After checking the block for correctness,
- *     we create a range struct for this block and add it to the range list.
+ *     we create a range struct for this block and add it to the range set.
  */
-static int add_range(range_t **ranges, char *lo, int size,
+static int add_range(range_set_t *ranges, char *lo, int size,
 		const trace_t *trace, int opnum, int index)
 {
 	char *hi = lo + size - 1;
-	range_t *p;
+	range_t *p, *prev, *next;
 
 	assert(size > 0);
 
@@ -531,33 +765,48 @@ static int add_range(range_t **ranges, char *lo, int size,
 		return 0;
 	}
 
-	/* If we can't afford the linear-time loop, we check less thoroughly and
-	   just assume the overlap will be caught by writing random bits. */
-	if(trace->ignore_ranges || debug_mode == DBG_NONE) return 1;
+	/* Without debugging we just assume the overlap will be caught by
+	   writing random bits. */
+	if(debug_mode == DBG_NONE) return 1;
 
-
-	/* The payload must not overlap any other payloads */
-	for (p = *ranges;  p != NULL;  p = p->next) {
-		if ((lo >= p->lo && lo <= p-> hi) ||
-				(hi >= p->lo && hi <= p->hi)) {
-			malloc_error(trace, opnum,
-					"Payload (%p:%p) overlaps another payload (%p:%p)\n",
-					lo, hi, p->lo, p->hi);
-			return 0;
-		}
+	/*
+	 * The payload must not overlap any other payloads. Since the set
+	 * holds no overlaps, only the blocks right below and right above
+	 * lo can collide with this one.
+	 */
+	prev = tree_find_nearest(ranges->lo_tree, (long unsigned)lo);
+	next = prev ? prev->next : ranges->list;
+	if (prev && lo <= prev->hi) {
+		malloc_error(trace, opnum,
+				"Payload (%p:%p) overlaps another payload (%p:%p)\n",
+				lo, hi, prev->lo, prev->hi);
+		return 0;
+	}
+	if (next && hi >= next->lo) {
+		malloc_error(trace, opnum,
+				"Payload (%p:%p) overlaps another payload (%p:%p)\n",
+				lo, hi, next->lo, next->hi);
+		return 0;
 	}
 
 	/*
 	 * Everything looks OK, so remember the extent of this block
-	 * by creating a range struct and adding it the range list.
+	 * by creating a range struct and adding it the range set.
 	 */
 	if ((p = (range_t *)malloc(sizeof(range_t))) == NULL)
 		unix_error("malloc error in add_range");
-	p->next = *ranges;
+	p->prev = prev;
+	if (prev)
+		prev->next = p;
+	else
+		ranges->list = p;
+	p->next = next;
+	if (next)
+		next->prev = p;
 	p->lo = lo;
 	p->hi = hi;
 	p->index = index;
-	*ranges = p;
+	tree_insert(ranges->lo_tree, (long unsigned)lo, (void *)p);
 
 	return 1;
 }
@@ -565,36 +814,29 @@ static int add_range(range_t **ranges, char *lo, int size,
 /*
  * remove_range - Free the range record of block whose payload starts at lo
  */
-static void remove_range(range_t **ranges, char *lo)
+static void remove_range(range_set_t *ranges, char *lo)
 {
-	range_t *p;
-	range_t **prevpp = ranges;
-	int size;
-
-	for (p = *ranges;  p != NULL; p = p->next) {
-		if (p->lo == lo) {
-			*prevpp = p->next;
-			size = p->hi - p->lo + 1;
-			free(p);
-			break;
-		}
-		prevpp = &(p->next);
-	}
+	range_t *p = (range_t *)tree_remove(ranges->lo_tree, (long unsigned)lo);
+
+	if (p == NULL)
+		return;
+	if (p->prev)
+		p->prev->next = p->next;
+	else
+		ranges->list = p->next;
+	if (p->next)
+		p->next->prev = p->prev;
+	free(p);
 }
 
 /*
  * clear_ranges - free all of the range records for a trace
  */
-static void clear_ranges(range_t **ranges)
+static void clear_ranges(range_set_t *ranges)
 {
-	range_t *p;
-	range_t *pnext;
-
-	for (p = *ranges;  p != NULL;  p = pnext) {
-		pnext = p->next;
-		free(p);
-	}
-	*ranges = NULL;
+	tree_free(ranges->lo_tree, free);
+	ranges->lo_tree = tree_new();
+	ranges->list = NULL;
 }
 
 /**********************************************
@@ -796,7 +1038,7 @@ static void free_trace(trace_t *trace)
 /*
  * eval_mm_valid - Check the mm malloc package for correctness
  */
-static int eval_mm_valid(trace_t *trace, range_t **ranges)
+static int eval_mm_valid(trace_t *trace, range_set_t *ranges)
 {
 	int i;
 	int index;
@@ -828,7 +1070,7 @@ static int eval_mm_valid(trace_t *trace, range_t **ranges)
 			mm_checkheap(verbose);
 
 			/* Now check that all our allocated blocks have the right data */
-			r = *ranges;
+			r = ranges->list;
 			while(r) {
 				check_index(trace, i, r->index);
 				r = r->next;
@@ -945,9 +1187,17 @@ static double eval_mm_util(trace_t *trace, int tracenum)
 	int total_size = 0;
 	char *p;
 	char *newp, *oldp;
+	sample_t *samples = NULL;
+	int nsamples = 0;
 
 	reinit_trace(trace);
 
+	if (timeline_fp != NULL) {
+		samples = calloc(trace->num_ops / sample_interval + 1, sizeof(sample_t));
+		if (samples == NULL)
+			unix_error("calloc failed in eval_mm_util");
+	}
+
 	/* initialize the heap and the mm malloc package */
 	mem_reset_brk();
 	if (mm_init() < 0)
@@ -1013,6 +1263,16 @@ static double eval_mm_util(trace_t *trace, int tracenum)
 		/* update the high-water mark */
 		max_total_size = (total_size > max_total_size) ?
 			total_size : max_total_size;
+
+		/* sample the heap every sample_interval requests, and at the end */
+		if (samples != NULL &&
+				((i + 1) % sample_interval == 0 || i == trace->num_ops - 1))
+			take_sample(&samples[nsamples++], i + 1, total_size);
+	}
+
+	if (samples != NULL) {
+		write_timeline(trace->filename, samples, nsamples);
+		free(samples);
 	}
 
 	printf(".");
@@ -1170,6 +1430,90 @@ static void eval_libc_speed(void *ptr)
 	}
 }
 
+/*****************************************************************
+ * The following routines record the fragmentation timeline: how
+ * the heap is split into allocated and free blocks as a trace runs.
+ ****************************************************************/
+
+/*
+ * visit_block - mm_heapwalk callback that accumulates one block
+ */
+static void visit_block(void *arg, size_t size, int alloc)
+{
+	sample_t *sample = (sample_t *)arg;
+
+	if (alloc) {
+		sample->alloc_blocks++;
+	} else {
+		sample->free_blocks++;
+		sample->free_bytes += size;
+		if (size > sample->largest_free)
+			sample->largest_free = size;
+	}
+}
+
+/*
+ * take_sample - Record the state of the heap after op requests, when
+ *     the trace has live bytes allocated
+ */
+static void take_sample(sample_t *sample, int op, size_t live)
+{
+	memset(sample, 0, sizeof(*sample));
+	sample->op = op;
+	sample->live = live;
+	sample->heapsize = mem_heapsize();
+	if (mm_heapwalk != NULL) {
+		sample->walked = 1;
+		mm_heapwalk(visit_block, sample);
+	}
+}
+
+/*
+ * write_timeline - Append the samples of one trace to the timeline file
+ */
+static void write_timeline(const char *filename, sample_t *samples, int n)
+{
+	int i;
+	sample_t *s;
+	double util;
+
+	if (timeline_json) {
+		fprintf(timeline_fp, "%s\n  {\"trace\": \"%s\", \"samples\": [",
+				timeline_count > 0 ? "," : "", filename);
+	}
+	for (i = 0; i < n; i++) {
+		s = &samples[i];
+		util = s->heapsize ? (double)s->live / (double)s->heapsize : 0;
+		if (timeline_json) {
+			fprintf(timeline_fp, "%s\n    {\"op\": %d, \"live_bytes\": %lu, "
+					"\"heap_bytes\": %lu, \"util\": %.4f",
+					i > 0 ? "," : "", s->op, (unsigned long)s->live,
+					(unsigned long)s->heapsize, util);
+			if (s->walked)
+				fprintf(timeline_fp, ", \"free_bytes\": %lu, "
+						"\"largest_free\": %lu, \"free_blocks\": %d, "
+						"\"alloc_blocks\": %d",
+						(unsigned long)s->free_bytes,
+						(unsigned long)s->largest_free,
+						s->free_blocks, s->alloc_blocks);
+			fprintf(timeline_fp, "}");
+		} else {
+			fprintf(timeline_fp, "%s,%d,%lu,%lu,%.4f", filename, s->op,
+					(unsigned long)s->live, (unsigned long)s->heapsize, util);
+			if (s->walked)
+				fprintf(timeline_fp, ",%lu,%lu,%d,%d\n",
+						(unsigned long)s->free_bytes,
+						(unsigned long)s->largest_free,
+						s->free_blocks, s->alloc_blocks);
+			else
+				fprintf(timeline_fp, ",,,,\n");
+		}
+	}
+	if (timeline_json)
+		fprintf(timeline_fp, "\n  ]}");
+	timeline_count++;
+}
+
 /*************************************
  * Some miscellaneous helper routines
  ************************************/
@@ -1282,7 +1626,7 @@ void malloc_error(const trace_t *trace, int opnum, const char *fmt, ...)
  */
 static void usage(void)
 {
-	fprintf(stderr, "Usage: mdriver [-hlVdD] [-f <file>]\n");
+	fprintf(stderr, "Usage: mdriver [-hlVdD] [-f <file>] [-T <file> [-i <n>]]\n");
 	fprintf(stderr, "Options\n");
 	fprintf(stderr, "\t-d <i>     Debug: 0 off; 1 default; 2 lots.\n");
 	fprintf(stderr, "\t-D         Equivalent to -d2.\n");
@@ -1293,5 +1637,8 @@ static void usage(void)
 	fprintf(stderr, "\t-V         Print diagnostics as each trace is run.\n");
 	fprintf(stderr, "\t-v <i>     Set Verbosity Level to <i>\n");
 	fprintf(stderr, "\t-s <s>     Timeout after s secs (default no timeout)\n");
+	fprintf(stderr, "\t-j <n>     Evaluate <n> traces in parallel (0: one per CPU).\n");
 	fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+	fprintf(stderr, "\t-T <file>  Write a fragmentation timeline to <file> (CSV, or JSON if *.json).\n");
+	fprintf(stderr, "\t-i <n>     Sample the timeline every <n> requests (default 100).\n");
 }
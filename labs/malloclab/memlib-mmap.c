@@ -0,0 +1,112 @@
+/*
+ * memlib-mmap.c - a real, growable heap behind the memlib.h interface.
+ *						Used instead of memlib.c when mm.c is built as the
+ *						process allocator (libmm.so), where there is no driver
+ *						to own the heap and nothing may call the system malloc.
+ *
+ * The whole address range is reserved up front without access rights,
+ * and mem_sbrk commits it in MEM_GRAIN steps, so memory only counts
+ * towards the RSS of the program once the allocator actually uses it.
+ */
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "memlib.h"
+
+#define MEM_RESERVE (1UL << 36)		/* 64 GB of address space */
+#define MEM_GRAIN	(1UL << 20)		/* commit 1 MB at a time */
+
+/* private variables */
+static char *heap;
+static char *mem_brk;
+static char *mem_commit;			/* end of the accessible part */
+static char *mem_max_addr;
+
+/*
+ * mem_init - reserve the address range of the heap
+ */
+void mem_init(void){
+	heap = mmap(NULL, MEM_RESERVE, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (heap == MAP_FAILED) {
+		heap = mem_brk = mem_commit = mem_max_addr = NULL;
+		return;
+	}
+	mem_max_addr = heap + MEM_RESERVE;
+	mem_brk = heap;
+	mem_commit = heap;
+}
+
+/*
+ * mem_deinit - give the heap back to the kernel
+ */
+void mem_deinit(void){
+	munmap(heap, MEM_RESERVE);
+}
+
+/*
+ * mem_reset_brk - reset the brk pointer to make an empty heap
+ */
+void mem_reset_brk(){
+	mem_brk = heap;
+}
+
+/*
+ * mem_sbrk - Extends the heap by incr bytes and returns the start
+ *		address of the new area, committing more of the reservation
+ *		when needed. As in memlib.c, the heap cannot be shrunk. No
+ *		message is printed: stdio may call back into malloc.
+ */
+void *mem_sbrk(int incr) {
+	char *old_brk = mem_brk;
+	char *new_commit;
+
+	if ((heap == NULL) || (incr < 0) ||
+			((size_t)incr > (size_t)(mem_max_addr - mem_brk))) {
+		errno = ENOMEM;
+		return (void *)-1;
+	}
+	if (mem_brk + incr > mem_commit) {
+		new_commit = heap + (((mem_brk + incr - heap) + MEM_GRAIN - 1)
+				/ MEM_GRAIN) * MEM_GRAIN;
+		if (new_commit > mem_max_addr)
+			new_commit = mem_max_addr;
+		if (mprotect(mem_commit, new_commit - mem_commit,
+					PROT_READ | PROT_WRITE) < 0) {
+			errno = ENOMEM;
+			return (void *)-1;
+		}
+		mem_commit = new_commit;
+	}
+	mem_brk += incr;
+	return (void *)old_brk;
+}
+
+/*
+ * mem_heap_lo - return address of the first heap byte
+ */
+void *mem_heap_lo(){
+	return (void *)heap;
+}
+
+/*
+ * mem_heap_hi - return address of last heap byte
+ */
+void *mem_heap_hi(){
+	return (void *)(mem_brk - 1);
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes
+ */
+size_t mem_heapsize() {
+	return (size_t)(mem_brk - heap);
+}
+
+/*
+ * mem_pagesize() - returns the page size of the system
+ */
+size_t mem_pagesize(){
+	return (size_t)getpagesize();
+}
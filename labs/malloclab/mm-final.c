@@ -289,6 +289,18 @@ void mm_checkheap(int verbose)
     } while (extract_size(curr) > 0);
 }
 
+void mm_heapwalk(mm_visit_t visit, void *arg)
+{
+    void *prologue_header =
+        ((char *)size_class_start) + SIZE_CLASS_NUMBER * DSIZE + WSIZE;
+    void *ptr;
+    for (ptr = header_next_neighbor(prologue_header); extract_size(ptr) != 0;
+         ptr = header_next_neighbor(ptr))
+    {
+        visit(arg, extract_size(ptr), extract_alloc(ptr));
+    }
+}
+
 // return the header of a free block
 static void *extend_heap(size_t size)
 {
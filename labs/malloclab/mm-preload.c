@@ -0,0 +1,247 @@
+/*
+ * mm-preload.c
+ *
+ * Exports the libc allocator interface on top of mm.c so that real
+ * programs can run on it:
+ *
+ *     unix> make libmm.so
+ *     unix> LD_PRELOAD=./libmm.so ./tiny 8000
+ *
+ * mm.c is compiled with -DDRIVER, so its entry points keep their mm_
+ * names and the heap comes from memlib-mmap.c instead of memlib.c.
+ * This file adds what a process allocator needs beyond the lab API:
+ * lazy initialization, a lock for threaded programs, and the 16-byte
+ * alignment (and memalign family) that x86-64 code expects, while
+ * mm.c only guarantees 8 bytes.
+ *
+ * Every block returned to the program is preceded by a tag holding
+ * the payload pointer that mm.c handed out and the requested size:
+ *
+ *     | mm.c payload ... | base | size | user data ...
+ *                                      ^ aligned pointer we return
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memlib.h"
+#include "mm.h"
+
+#define MIN_ALIGN 16
+
+typedef struct
+{
+    void *base;  /* pointer returned by mm_malloc */
+    size_t size; /* bytes requested by the program */
+} tag_t;
+
+/* The largest request mm.c can represent in its 32-bit headers */
+static const size_t MAX_REQUEST = (size_t)1 << 30;
+
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+static int mm_ready;
+
+static void lock_for_fork(void)
+{
+    pthread_mutex_lock(&mm_lock);
+}
+
+static void unlock_after_fork(void)
+{
+    pthread_mutex_unlock(&mm_lock);
+}
+
+// call with mm_lock held; returns 0 once the heap is usable
+static int ensure_init(void)
+{
+    if (mm_ready)
+        return 0;
+    mem_init();
+    if (mm_init() < 0)
+        return -1;
+    pthread_atfork(lock_for_fork, unlock_after_fork, unlock_after_fork);
+    mm_ready = 1;
+    return 0;
+}
+
+static tag_t *user_to_tag(void *user)
+{
+    return ((tag_t *)user) - 1;
+}
+
+// allocate size bytes aligned to align (a power of two >= MIN_ALIGN)
+static void *alloc_aligned(size_t align, size_t size)
+{
+    void *base, *user;
+    uintptr_t p;
+
+    if (size > MAX_REQUEST || align > MAX_REQUEST)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pthread_mutex_lock(&mm_lock);
+    if (ensure_init() < 0)
+        base = NULL;
+    else
+        base = mm_malloc(size + sizeof(tag_t) + align - 8);
+    pthread_mutex_unlock(&mm_lock);
+    if (base == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    p = ((uintptr_t)base + sizeof(tag_t) + align - 1) &
+        ~(uintptr_t)(align - 1);
+    user = (void *)p;
+    user_to_tag(user)->base = base;
+    user_to_tag(user)->size = size;
+    return user;
+}
+
+void *malloc(size_t size)
+{
+    return alloc_aligned(MIN_ALIGN, size ? size : 1);
+}
+
+void free(void *ptr)
+{
+    if (ptr == NULL)
+        return;
+    pthread_mutex_lock(&mm_lock);
+    mm_free(user_to_tag(ptr)->base);
+    pthread_mutex_unlock(&mm_lock);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+    size_t bytes;
+
+    if (size != 0 && nmemb > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    bytes = nmemb * size;
+    // not malloc(): gcc would fold malloc + memset back into calloc()
+    if ((ptr = alloc_aligned(MIN_ALIGN, bytes ? bytes : 1)) != NULL)
+        memset(ptr, 0, bytes);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    tag_t old;
+    size_t offset, keep;
+    void *base, *user;
+    uintptr_t p;
+
+    if (ptr == NULL)
+        return malloc(size);
+    if (size == 0)
+    {
+        free(ptr);
+        return NULL;
+    }
+    if (size > MAX_REQUEST)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    old = *user_to_tag(ptr);
+    offset = (char *)ptr - (char *)old.base;
+    keep = old.size < size ? old.size : size;
+
+    // over-aligned blocks may not fit in place; move them by hand
+    if (offset > sizeof(tag_t) + MIN_ALIGN - 8)
+    {
+        if ((user = malloc(size)) == NULL)
+            return NULL;
+        memcpy(user, ptr, keep);
+        free(ptr);
+        return user;
+    }
+
+    // mm_realloc keeps the data at the same offset from the payload
+    pthread_mutex_lock(&mm_lock);
+    base = mm_realloc(old.base, size + sizeof(tag_t) + MIN_ALIGN - 8);
+    pthread_mutex_unlock(&mm_lock);
+    if (base == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    p = ((uintptr_t)base + sizeof(tag_t) + MIN_ALIGN - 1) &
+        ~(uintptr_t)(MIN_ALIGN - 1);
+    user = (void *)p;
+    if ((char *)user != (char *)base + offset)
+        memmove(user, (char *)base + offset, keep);
+    user_to_tag(user)->base = base;
+    user_to_tag(user)->size = size;
+    return user;
+}
+
+void *reallocarray(void *ptr, size_t nmemb, size_t size)
+{
+    if (size != 0 && nmemb > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, nmemb * size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+        alignment % sizeof(void *) != 0)
+        return EINVAL;
+    if (alignment < MIN_ALIGN)
+        alignment = MIN_ALIGN;
+    if ((ptr = alloc_aligned(alignment, size ? size : 1)) == NULL)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (alignment < MIN_ALIGN)
+        alignment = MIN_ALIGN;
+    return alloc_aligned(alignment, size ? size : 1);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+void *valloc(size_t size)
+{
+    return memalign(getpagesize(), size);
+}
+
+void *pvalloc(size_t size)
+{
+    size_t page = getpagesize();
+
+    return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    return ptr ? user_to_tag(ptr)->size : 0;
+}
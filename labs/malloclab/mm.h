@@ -23,3 +23,9 @@ extern int mm_init(void);
 /* This is largely for debugging.  You can do what you want with the
    verbose flag; we don't care. */
 extern void mm_checkheap(int verbose);
+
+/* Optional: calls visit once per heap block, in address order, with the
+   block size (including overhead) and whether it is allocated.  The
+   driver uses it to sample fragmentation over time (mdriver -T). */
+typedef void (*mm_visit_t)(void *arg, size_t size, int alloc);
+extern void mm_heapwalk(mm_visit_t visit, void *arg);
@@ -0,0 +1,39 @@
+/*
+ * bintrace.h - On-disk format of the binary allocation traces written
+ *     by record-trace.so and read by convert-bin-trace-to-rep.
+ *
+ * A trace file is a BINTRACE_MAGIC header followed by a flat array of
+ * fixed-size records.  Each thread logs into its own buffer, so the
+ * records of different threads are interleaved in chunks on disk; the
+ * seq field (a process-wide counter) restores the real request order.
+ *
+ * A realloc that moves the block is logged as two records: an 'r' that
+ * releases oldptr, numbered before the call, and an 'R' for the new
+ * block, numbered after it, so that neither address is seen live by
+ * two requests at once.
+ */
+#ifndef __BINTRACE_H_
+#define __BINTRACE_H_
+
+#include <stdint.h>
+
+#define BINTRACE_MAGIC "MMTRACE1"
+#define BINTRACE_MAGIC_LEN 8
+
+/* Request types, chosen to match the text format of get-trace.c */
+#define BT_MALLOC  'm'  /* ptr = malloc(size), also memalign and friends */
+#define BT_CALLOC  'c'  /* ptr = calloc(n, m); size = n * m */
+#define BT_REALLOC 'r'  /* ptr = realloc(oldptr, size); ptr is 0 if it moved */
+#define BT_MOVED   'R'  /* the block a moving realloc returned, in ptr;
+                           oldptr holds the seq of its 'r' record */
+#define BT_FREE    'f'  /* free(ptr) */
+
+typedef struct {
+	uint64_t seq;    /* global request number */
+	uint64_t ptr;    /* returned pointer (m, c, r) or freed pointer (f) */
+	uint64_t oldptr; /* realloc only: the pointer passed in */
+	uint32_t size;   /* requested bytes, saturated at UINT32_MAX */
+	uint32_t op;     /* one of the BT_xxx constants */
+} bintrace_rec_t;
+
+#endif /* __BINTRACE_H_ */
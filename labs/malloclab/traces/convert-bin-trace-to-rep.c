@@ -0,0 +1,292 @@
+/*
+ * convert-bin-trace-to-rep.c - Translate a binary trace written by
+ * record-trace.so into the .rep format read by mdriver.
+ *
+ *   unix> ./convert-bin-trace-to-rep [-w <weight>] <file.bin> > <file.rep>
+ *
+ * Records are put back into request order using their sequence
+ * numbers, and every live pointer is given a request id the same way
+ * convert-exec-trace-to-rep does for get-trace.c output.  Requests the
+ * driver cannot replay are adjusted rather than rejected:
+ *
+ * - zero-byte malloc/calloc requests become 1-byte requests, since the
+ *   driver treats a NULL return as a failure;
+ * - realloc(NULL, n) becomes an allocate, realloc(p, 0) a free;
+ * - a free of a pointer we never saw allocated is dropped;
+ * - if an address comes back while we still think it is live (possible
+ *   when two threads race on the same block), the old id is retired.
+ *
+ * The number of adjusted requests is reported on stderr.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bintrace.h"
+
+/* Open-addressing map from live pointer to request id */
+typedef struct {
+    uint64_t ptr;   /* 0 marks an empty slot */
+    int id;
+} slot_t;
+
+static slot_t *slots;
+static size_t nslots;   /* always a power of two */
+static size_t nlive;
+
+static int dropped, retired;
+
+/* Moving reallocs whose 'R' record has not come yet */
+typedef struct {
+    uint64_t seq;   /* of the 'r' record */
+    int id;
+} move_t;
+
+static move_t *moves;
+static size_t nmoves, maxmoves;
+
+static void die(const char *msg)
+{
+    fprintf(stderr, "convert-bin-trace-to-rep: %s\n", msg);
+    exit(1);
+}
+
+static size_t hash(uint64_t ptr)
+{
+    return (size_t)((ptr >> 4) * 0x9E3779B97F4A7C15ULL);
+}
+
+static slot_t *lookup(uint64_t ptr)
+{
+    size_t i = hash(ptr) & (nslots - 1);
+
+    while (slots[i].ptr != 0 && slots[i].ptr != ptr)
+        i = (i + 1) & (nslots - 1);
+    return &slots[i];
+}
+
+static void insert(uint64_t ptr, int id);
+
+static void grow(void)
+{
+    slot_t *old = slots;
+    size_t i, oldn = nslots;
+
+    nslots = oldn ? 2 * oldn : 1024;
+    if ((slots = calloc(nslots, sizeof(slot_t))) == NULL)
+        die("out of memory");
+    nlive = 0;
+    for (i = 0; i < oldn; i++)
+        if (old[i].ptr != 0)
+            insert(old[i].ptr, old[i].id);
+    free(old);
+}
+
+static void insert(uint64_t ptr, int id)
+{
+    slot_t *s;
+
+    if (2 * (nlive + 1) > nslots)
+        grow();
+    s = lookup(ptr);
+    if (s->ptr == 0)
+        nlive++;
+    else
+        retired++;
+    s->ptr = ptr;
+    s->id = id;
+}
+
+/*
+ * take - Remove ptr from the map and return its id, or -1 if not live
+ */
+static int take(uint64_t ptr)
+{
+    slot_t *s = lookup(ptr);
+    size_t i, j;
+    int id;
+
+    if (s->ptr == 0)
+        return -1;
+    id = s->id;
+
+    /* Backward-shift deletion keeps the probe sequences intact */
+    i = s - slots;
+    j = i;
+    for (;;) {
+        size_t home;
+
+        j = (j + 1) & (nslots - 1);
+        if (slots[j].ptr == 0)
+            break;
+        home = hash(slots[j].ptr) & (nslots - 1);
+        if ((j > i && (home <= i || home > j)) ||
+            (j < i && (home <= i && home > j))) {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i].ptr = 0;
+    nlive--;
+    return id;
+}
+
+static void move_start(uint64_t seq, int id)
+{
+    if (nmoves == maxmoves) {
+        maxmoves = maxmoves ? 2 * maxmoves : 16;
+        if ((moves = realloc(moves, maxmoves * sizeof(move_t))) == NULL)
+            die("out of memory");
+    }
+    moves[nmoves].seq = seq;
+    moves[nmoves].id = id;
+    nmoves++;
+}
+
+/*
+ * move_finish - Return the id of the moving realloc numbered seq, or
+ *     -1 if there is none; only one per thread is ever in flight
+ */
+static int move_finish(uint64_t seq)
+{
+    size_t i;
+    int id;
+
+    for (i = 0; i < nmoves; i++) {
+        if (moves[i].seq == seq) {
+            id = moves[i].id;
+            moves[i] = moves[--nmoves];
+            return id;
+        }
+    }
+    return -1;
+}
+
+static int cmp_seq(const void *a, const void *b)
+{
+    uint64_t x = ((const bintrace_rec_t *)a)->seq;
+    uint64_t y = ((const bintrace_rec_t *)b)->seq;
+
+    return (x > y) - (x < y);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: convert-bin-trace-to-rep [-w <weight>] <file>\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    char magic[BINTRACE_MAGIC_LEN];
+    bintrace_rec_t *recs = NULL;
+    size_t nrecs = 0, cap = 0, i, nops = 0;
+    char (*out)[40];
+    int weight = 1, nids = 0, id, c;
+
+    while ((c = getopt(argc, argv, "w:")) != -1) {
+        switch (c) {
+        case 'w':
+            weight = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind != argc - 1)
+        usage();
+
+    if ((fp = fopen(argv[optind], "rb")) == NULL)
+        die("cannot open trace file");
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, BINTRACE_MAGIC, BINTRACE_MAGIC_LEN) != 0)
+        die("not a record-trace.so trace");
+
+    for (;;) {
+        if (nrecs == cap) {
+            cap = cap ? 2 * cap : 65536;
+            if ((recs = realloc(recs, cap * sizeof(*recs))) == NULL)
+                die("out of memory");
+        }
+        size_t n = fread(recs + nrecs, sizeof(*recs), cap - nrecs, fp);
+        nrecs += n;
+        if (n == 0)
+            break;
+    }
+    fclose(fp);
+
+    qsort(recs, nrecs, sizeof(*recs), cmp_seq);
+    grow();
+
+    /* At most one output line per record */
+    if ((out = malloc((nrecs ? nrecs : 1) * sizeof(*out))) == NULL)
+        die("out of memory");
+
+    for (i = 0; i < nrecs; i++) {
+        bintrace_rec_t *r = &recs[i];
+        uint32_t size = r->size ? r->size : 1;
+
+        switch (r->op) {
+        case BT_MALLOC:
+        case BT_CALLOC:
+            insert(r->ptr, nids);
+            sprintf(out[nops++], "a %d %u", nids++, size);
+            break;
+
+        case BT_REALLOC:
+            id = r->oldptr ? take(r->oldptr) : -1;
+            if (r->size == 0) {
+                /* realloc(p, 0) frees p */
+                if (id >= 0)
+                    sprintf(out[nops++], "f %d", id);
+                else if (r->oldptr)
+                    dropped++;
+                break;
+            }
+            if (id < 0) {
+                if (r->oldptr)
+                    dropped++;
+                id = nids++;
+                sprintf(out[nops++], "a %d %u", id, size);
+            } else
+                sprintf(out[nops++], "r %d %u", id, size);
+            /* A moved block only becomes live at its 'R' record */
+            if (r->ptr)
+                insert(r->ptr, id);
+            else
+                move_start(r->seq, id);
+            break;
+
+        case BT_MOVED:
+            if ((id = move_finish(r->oldptr)) >= 0)
+                insert(r->ptr, id);
+            break;
+
+        case BT_FREE:
+            if ((id = take(r->ptr)) >= 0)
+                sprintf(out[nops++], "f %d", id);
+            else
+                dropped++;
+            break;
+
+        default:
+            die("bad record type");
+        }
+    }
+
+    printf("%d\n%d\n%lu\n0\n", weight, nids, (unsigned long)nops);
+    for (i = 0; i < nops; i++)
+        printf("%s\n", out[i]);
+
+    if (dropped || retired)
+        fprintf(stderr, "convert-bin-trace-to-rep: %d unmatched frees "
+                "dropped, %d stale ids retired\n", dropped, retired);
+    free(out);
+    free(recs);
+    free(slots);
+    free(moves);
+    return 0;
+}
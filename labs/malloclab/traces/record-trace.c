@@ -0,0 +1,484 @@
+/*
+ * record-trace.c - LD_PRELOAD shim that records the malloc, calloc,
+ * realloc and free requests of a running program.
+ *
+ * Unlike get-trace.c, every request is forwarded to the real libc
+ * allocator, so the traced program keeps its normal behavior and
+ * speed.  Each thread appends fixed-size binary records (bintrace.h)
+ * to a private chunk without taking any lock; full chunks are handed
+ * to a background thread that writes them out, so the hooks never
+ * wait on I/O.
+ *
+ *   unix> make record-trace.so convert-bin-trace-to-rep
+ *   unix> RECORD_TRACE_OUTPUT=/tmp/ls LD_PRELOAD=./record-trace.so ls
+ *   unix> ./convert-bin-trace-to-rep /tmp/ls.<pid>.bin > ls.rep
+ *
+ * The output file is named after the RECORD_TRACE_OUTPUT envvar
+ * (default /tmp/trace) and the pid, so forked children get their own.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bintrace.h"
+
+#define CHUNK_RECS 4096     /* records per thread buffer (128KB) */
+#define BOOT_HEAP_LEN 8192  /* serves dlsym's own allocations */
+
+#define TLS __thread __attribute__((tls_model("initial-exec")))
+
+typedef struct chunk {
+    struct chunk *next;     /* link in the active, full or spare list */
+    struct chunk *prev;     /* back link, used in the active list only */
+    size_t n;               /* number of records filled in */
+    bintrace_rec_t recs[CHUNK_RECS];
+} chunk_t;
+
+/* The real allocator, looked up with dlsym */
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void (*real_free)(void *);
+static int (*real_posix_memalign)(void **, size_t, size_t);
+static void *(*real_aligned_alloc)(size_t, size_t);
+static void *(*real_memalign)(size_t, size_t);
+
+static char boot_heap[BOOT_HEAP_LEN] __attribute__((aligned(16)));
+static size_t boot_used;
+static int resolving;
+
+/* Global request counter; restores the order across threads */
+static uint64_t next_seq;
+
+/*
+ * Chunk bookkeeping, all protected by lock.  Chunks owned by a thread
+ * sit on the active list so that they can be rescued at exit; full
+ * ones wait on the full queue for the writer; written ones are kept
+ * on the spare list for reuse.
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t full_cond = PTHREAD_COND_INITIALIZER;
+static chunk_t *active;
+static chunk_t *full_head, *full_tail;
+static chunk_t *spare;
+static int started;         /* writer thread running */
+static int stopping;        /* writer should drain and exit */
+static int closing;         /* process is exiting; stop recording */
+static int outfd = -1;
+static pthread_t writer;
+static pthread_key_t exit_key;
+
+static TLS chunk_t *cur;    /* this thread's chunk */
+static TLS int in_hook;     /* set while the recorder itself allocates */
+
+/*
+ * resolve - Look up the real allocator.  dlsym may itself call
+ *     malloc or calloc; those calls are served from boot_heap.
+ */
+static void resolve(void)
+{
+    resolving = 1;
+    real_malloc = dlsym(RTLD_NEXT, "malloc");
+    real_calloc = dlsym(RTLD_NEXT, "calloc");
+    real_realloc = dlsym(RTLD_NEXT, "realloc");
+    real_free = dlsym(RTLD_NEXT, "free");
+    real_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    real_aligned_alloc = dlsym(RTLD_NEXT, "aligned_alloc");
+    real_memalign = dlsym(RTLD_NEXT, "memalign");
+    resolving = 0;
+}
+
+static void *boot_alloc(size_t size)
+{
+    void *p;
+
+    size = (size + 15) & ~(size_t)15;
+    if (boot_used + size > BOOT_HEAP_LEN)
+        return NULL;
+    p = boot_heap + boot_used;
+    boot_used += size;
+    return p;
+}
+
+static int is_boot(void *p)
+{
+    return (char *)p >= boot_heap && (char *)p < boot_heap + BOOT_HEAP_LEN;
+}
+
+static void write_all(const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write(outfd, p, len)) <= 0)
+            return;
+        p += n;
+        len -= n;
+    }
+}
+
+/*
+ * writer_main - Body of the background thread that writes full chunks
+ */
+static void *writer_main(void *arg)
+{
+    chunk_t *c, *batch;
+
+    (void)arg;
+    in_hook = 1;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (full_head == NULL && !stopping)
+            pthread_cond_wait(&full_cond, &lock);
+        if (full_head == NULL)
+            break;
+        batch = full_head;
+        full_head = full_tail = NULL;
+        pthread_mutex_unlock(&lock);
+
+        /* Only the records published by the owner (see record) */
+        for (c = batch; c != NULL; c = c->next)
+            write_all(c->recs, __atomic_load_n(&c->n, __ATOMIC_ACQUIRE) *
+                      sizeof(bintrace_rec_t));
+
+        pthread_mutex_lock(&lock);
+        while (batch != NULL) {
+            c = batch;
+            batch = batch->next;
+            c->next = spare;
+            spare = c;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+/*
+ * start_writer - Open the output file and start the writer thread.
+ *     Called with lock held.
+ */
+static void start_writer(void)
+{
+    const char *prefix = getenv("RECORD_TRACE_OUTPUT");
+    char name[4096];
+
+    if (prefix == NULL)
+        prefix = "/tmp/trace";
+    snprintf(name, sizeof(name), "%s.%u.bin", prefix, (unsigned)getpid());
+    outfd = open(name, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0666);
+    if (outfd >= 0)
+        write_all(BINTRACE_MAGIC, BINTRACE_MAGIC_LEN);
+    stopping = 0;
+    started = 1;
+    pthread_create(&writer, NULL, writer_main, NULL);
+}
+
+static void active_unlink(chunk_t *c)
+{
+    if (c->prev)
+        c->prev->next = c->next;
+    else
+        active = c->next;
+    if (c->next)
+        c->next->prev = c->prev;
+}
+
+static void full_push(chunk_t *c)
+{
+    c->next = NULL;
+    if (full_tail)
+        full_tail->next = c;
+    else
+        full_head = c;
+    full_tail = c;
+}
+
+/*
+ * retire - Queue this thread's chunk for writing.  Called with lock held.
+ */
+static void retire(chunk_t *c)
+{
+    active_unlink(c);
+    full_push(c);
+    pthread_cond_signal(&full_cond);
+}
+
+/*
+ * thread_exit - pthread key destructor that queues the partially
+ *     filled chunk of an exiting thread
+ */
+static void thread_exit(void *arg)
+{
+    chunk_t *c = arg;
+
+    pthread_mutex_lock(&lock);
+    if (c == cur && !closing) {
+        retire(c);
+        cur = NULL;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * get_chunk - Retire the current chunk (if any) and give the calling
+ *     thread an empty one.  Returns NULL once recording has stopped.
+ */
+static chunk_t *get_chunk(void)
+{
+    chunk_t *c;
+
+    pthread_mutex_lock(&lock);
+    if (closing) {
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+    if (!started)
+        start_writer();
+    if (cur != NULL)
+        retire(cur);
+    if ((c = spare) != NULL) {
+        spare = c->next;
+    } else {
+        c = mmap(NULL, sizeof(chunk_t), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (c == MAP_FAILED) {
+            cur = NULL;
+            pthread_mutex_unlock(&lock);
+            return NULL;
+        }
+    }
+    c->n = 0;
+    c->prev = NULL;
+    c->next = active;
+    if (active)
+        active->prev = c;
+    active = c;
+    cur = c;
+    pthread_mutex_unlock(&lock);
+
+    pthread_setspecific(exit_key, c);
+    return c;
+}
+
+static uint64_t take_seq(void)
+{
+    return __atomic_fetch_add(&next_seq, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * record - Append one request to this thread's chunk.  At exit the
+ *     chunk may be handed to the writer while this thread still runs,
+ *     so a record is filled in first and only then counted in n, with
+ *     a release store the writer pairs with.
+ */
+static void record(uint64_t seq, int op, void *ptr, void *oldptr,
+                   size_t size)
+{
+    chunk_t *c;
+    bintrace_rec_t *r;
+
+    if (in_hook || __atomic_load_n(&closing, __ATOMIC_RELAXED))
+        return;
+    in_hook = 1;
+    c = cur;
+    if (c == NULL || c->n == CHUNK_RECS)
+        c = get_chunk();
+    if (c != NULL) {
+        r = &c->recs[c->n];
+        r->seq = seq;
+        r->ptr = (uint64_t)(uintptr_t)ptr;
+        r->oldptr = (uint64_t)(uintptr_t)oldptr;
+        r->size = size > UINT32_MAX ? UINT32_MAX : (uint32_t)size;
+        r->op = op;
+        __atomic_store_n(&c->n, c->n + 1, __ATOMIC_RELEASE);
+    }
+    in_hook = 0;
+}
+
+/*
+ * Fork handlers: the child keeps none of the parent's chunks and
+ * starts its own output file on its first request.
+ */
+static void before_fork(void)
+{
+    pthread_mutex_lock(&lock);
+}
+
+static void after_fork_parent(void)
+{
+    pthread_mutex_unlock(&lock);
+}
+
+static void after_fork_child(void)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&full_cond, NULL);
+    active = full_head = full_tail = NULL;
+    cur = NULL;
+    started = 0;
+    if (outfd >= 0)
+        close(outfd);
+    outfd = -1;
+}
+
+static void __attribute__((constructor)) record_init(void)
+{
+    if (real_malloc == NULL)
+        resolve();
+    pthread_key_create(&exit_key, thread_exit);
+    pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+}
+
+/*
+ * record_fini - Stop recording, then write out every chunk, including
+ *     the partially filled ones still owned by running threads.  Those
+ *     threads may still add a record they began before closing was
+ *     set; the writer takes only what was published when it gets to
+ *     the chunk, and the chunk is never reused afterwards.
+ */
+static void __attribute__((destructor)) record_fini(void)
+{
+    chunk_t *c;
+
+    pthread_mutex_lock(&lock);
+    __atomic_store_n(&closing, 1, __ATOMIC_RELAXED);
+    while ((c = active) != NULL) {
+        active_unlink(c);
+        full_push(c);
+    }
+    stopping = 1;
+    pthread_cond_signal(&full_cond);
+    pthread_mutex_unlock(&lock);
+
+    if (started) {
+        pthread_join(writer, NULL);
+        close(outfd);
+    }
+}
+
+/*
+ * The interposed allocator functions.  Frees take their sequence
+ * number before the block is released, and allocations after the
+ * block is obtained, so that a freed address is never handed out
+ * again earlier in the recorded order.
+ */
+void *malloc(size_t size)
+{
+    void *p;
+
+    if (real_malloc == NULL) {
+        if (resolving)
+            return boot_alloc(size);
+        resolve();
+    }
+    if ((p = real_malloc(size)) != NULL)
+        record(take_seq(), BT_MALLOC, p, NULL, size);
+    return p;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (real_calloc == NULL) {
+        if (resolving)
+            return boot_alloc(nmemb * size); /* boot_heap is zeroed */
+        resolve();
+    }
+    if ((p = real_calloc(nmemb, size)) != NULL)
+        record(take_seq(), BT_CALLOC, p, NULL, nmemb * size);
+    return p;
+}
+
+/*
+ * realloc may release oldp and obtain another block in one call, so it
+ * takes a sequence number on each side of it: oldp is released at the
+ * first and a moved block is recorded (BT_MOVED) at the second.
+ */
+void *realloc(void *oldp, size_t size)
+{
+    void *p;
+    uint64_t seq;
+    size_t len;
+
+    if (real_realloc == NULL)
+        resolve();
+    if (is_boot(oldp)) {
+        /* Never recorded, so show it as a fresh allocation */
+        len = boot_heap + BOOT_HEAP_LEN - (char *)oldp;
+        if ((p = malloc(size)) != NULL)
+            memcpy(p, oldp, size < len ? size : len);
+        return p;
+    }
+    if (oldp == NULL) {
+        if ((p = real_realloc(NULL, size)) != NULL)
+            record(take_seq(), BT_REALLOC, p, NULL, size);
+        return p;
+    }
+
+    seq = take_seq();
+    p = real_realloc(oldp, size);
+    if (p == oldp || (p == NULL && size == 0)) {
+        record(seq, BT_REALLOC, p, oldp, size);
+    } else if (p != NULL && size == 0) {
+        /* Freed oldp but still returned a block */
+        record(seq, BT_FREE, oldp, NULL, 0);
+        record(take_seq(), BT_MALLOC, p, NULL, 0);
+    } else if (p != NULL) {
+        record(seq, BT_REALLOC, NULL, oldp, size);
+        record(take_seq(), BT_MOVED, p, (void *)(uintptr_t)seq, size);
+    }
+    return p;
+}
+
+void free(void *p)
+{
+    if (p == NULL || is_boot(p))
+        return;
+    if (real_free == NULL)
+        resolve();
+    record(take_seq(), BT_FREE, p, NULL, 0);
+    real_free(p);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    int rc;
+
+    if (real_posix_memalign == NULL)
+        resolve();
+    if ((rc = real_posix_memalign(memptr, alignment, size)) == 0)
+        record(take_seq(), BT_MALLOC, *memptr, NULL, size);
+    return rc;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    void *p;
+
+    if (real_aligned_alloc == NULL)
+        resolve();
+    if ((p = real_aligned_alloc(alignment, size)) != NULL)
+        record(take_seq(), BT_MALLOC, p, NULL, size);
+    return p;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *p;
+
+    if (real_memalign == NULL)
+        resolve();
+    if ((p = real_memalign(alignment, size)) != NULL)
+        record(take_seq(), BT_MALLOC, p, NULL, size);
+    return p;
+}